@@ -11,6 +11,9 @@
 #include <algorithm>
 #include <cstdint>
 #include <cassert>
+#include <cstddef>
+#include <optional>
+#include <cstdlib>
 
 namespace baseline
 {
@@ -21,6 +24,60 @@ using std::size_t;
 constexpr uint32_t COST_0 = 1'000;
 constexpr uint32_t COST_1 = 1'414;
 using Point = std::pair<int,int>;
+// write p to a GPPC location type with x and y members
+template <typename Loc>
+inline void to_loc(Loc& L, Point p) noexcept
+{
+	L.x = p.first; L.y = p.second;
+}
+/**
+ * Per-query scratch memory.
+ * A monotonic buffer over an owned block, rewound by `reset` at the start of every query.
+ * When a query spills past the block the spill is taken from the heap and the block is grown
+ * by that amount on the next reset, so steady-state queries perform no heap allocations.
+ * Containers using `resource()` must be destroyed before `reset`.
+ */
+class QueryArena
+{
+public:
+	explicit QueryArena(size_t initial = size_t{1} << 16) : block(initial)
+	{
+		arena.emplace(block.data(), block.size(), &spill);
+	}
+	QueryArena(const QueryArena&) = delete;
+	QueryArena& operator=(const QueryArena&) = delete;
+
+	std::pmr::memory_resource* resource() noexcept { return &*arena; }
+	void reset()
+	{
+		arena.reset(); // returns any spill to the heap
+		if (spill.bytes != 0) {
+			block.resize(block.size() + spill.bytes);
+			spill.bytes = 0;
+		}
+		arena.emplace(block.data(), block.size(), &spill);
+	}
+
+private:
+	struct SpillResource : std::pmr::memory_resource
+	{
+		size_t bytes = 0;
+		void* do_allocate(size_t n, size_t align) override
+		{
+			bytes += n;
+			return std::pmr::new_delete_resource()->allocate(n, align);
+		}
+		void do_deallocate(void* p, size_t n, size_t align) override
+		{
+			std::pmr::new_delete_resource()->deallocate(p, n, align);
+		}
+		bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override { return this == &o; }
+	};
+	std::vector<std::byte> block;
+	SpillResource spill;
+	std::optional<std::pmr::monotonic_buffer_resource> arena;
+};
+
 struct Node
 {
 	static constexpr uint32_t INV = std::numeric_limits<uint32_t>::max();
@@ -31,18 +88,68 @@ struct Node
 	uint32_t pred;
 	uint32_t cost;
 };
+/**
+ * Row-major cell order, id = y * width + x.
+ * The grid reads the caller's bitmap directly.
+ */
+struct RowMajorLayout
+{
+	static constexpr bool identity = true;
+	RowMajorLayout(uint32_t l_width, uint32_t l_height) noexcept : width(l_width), height(l_height)
+	{ }
+	size_t size() const noexcept { return static_cast<size_t>(width) * height; }
+	uint32_t pack(uint32_t x, uint32_t y) const noexcept { return y * width + x; }
+	Point unpack(uint32_t p) const noexcept
+	{
+		return Point(static_cast<int>(p % width), static_cast<int>(p / width));
+	}
+	uint32_t width;
+	uint32_t height;
+};
+/**
+ * Blocked cell order, the map is cut into (1 << TileBits)^2 tiles stored contiguously and row-major
+ * inside each tile, so all 8 neighbours of a cell are usually within one or two cache lines of Node.
+ * The map is padded to whole tiles, padding cells are obstacles.
+ */
+template <uint32_t TileBits = 3>
+struct TiledLayout
+{
+	static constexpr bool identity = false;
+	static constexpr uint32_t TILE = 1u << TileBits;
+	static constexpr uint32_t MASK = TILE - 1;
+	TiledLayout(uint32_t l_width, uint32_t l_height) noexcept :
+		 tiles_x((l_width + MASK) >> TileBits)
+		,tiles_y((l_height + MASK) >> TileBits)
+	{ }
+	size_t size() const noexcept { return static_cast<size_t>(tiles_x) * tiles_y * TILE * TILE; }
+	uint32_t pack(uint32_t x, uint32_t y) const noexcept
+	{
+		return (((y >> TileBits) * tiles_x + (x >> TileBits)) << (2 * TileBits)) | ((y & MASK) << TileBits) | (x & MASK);
+	}
+	Point unpack(uint32_t p) const noexcept
+	{
+		uint32_t tile = p >> (2 * TileBits);
+		return Point(static_cast<int>((tile % tiles_x) << TileBits | (p & MASK)),
+		             static_cast<int>((tile / tiles_x) << TileBits | ((p >> TileBits) & MASK)));
+	}
+	uint32_t tiles_x;
+	uint32_t tiles_y;
+};
+
+template <typename Layout = RowMajorLayout>
 struct Grid
 {
+	using layout_type = Layout;
 	size_t size() const noexcept { return cells->size(); }
 	uint32_t pack(Point p) const noexcept
 	{
 		assert(static_cast<uint32_t>(p.first) < width && static_cast<uint32_t>(p.second) < height);
-		return static_cast<uint32_t>(p.second) * width + static_cast<uint32_t>(p.first);
+		return layout.pack(static_cast<uint32_t>(p.first), static_cast<uint32_t>(p.second));
 	}
 	Point unpack(uint32_t p) const noexcept
 	{
 		assert(width != 0 && p < size());
-		return Point(static_cast<int>(p % width), static_cast<int>(p / width));
+		return layout.unpack(p);
 	}
 	bool get(uint32_t p) const noexcept
 	{
@@ -58,61 +165,92 @@ struct Grid
 	Grid(const std::vector<bool>& l_cells, int l_width, int l_height) :
 		 width(static_cast<uint32_t>(l_width))
 		,height(static_cast<uint32_t>(l_height))
+		,layout(width, height)
 		,cells(&l_cells)
-	{ }
+	{
+		if constexpr (!Layout::identity) {
+			// permute the row-major input bitmap into layout order
+			layout_cells.assign(layout.size(), false);
+			for (uint32_t y = 0; y < height; ++y)
+			for (uint32_t x = 0; x < width; ++x) {
+				layout_cells[layout.pack(x, y)] = l_cells[static_cast<size_t>(y) * width + x];
+			}
+			cells = &layout_cells;
+		}
+	}
+	Grid(const Grid&) = delete;
+	Grid& operator=(const Grid&) = delete;
 
 	uint32_t width;
 	uint32_t height;
+	Layout layout;
 	const std::vector<bool>* cells;
+	std::vector<bool> layout_cells;
 	std::vector<Node> nodes;
 };
 
-void path_to_root(const Grid& grid, Point start, std::vector<Point>& out);
-void setup_grid(Grid& grid);
+template <typename Layout>
+void path_to_root(const Grid<Layout>& grid, Point start, std::vector<Point>& out);
+template <typename Layout>
+void setup_grid(Grid<Layout>& grid);
 
-struct SpanningTreeSearch : Grid
+template <typename Layout = RowMajorLayout>
+struct SpanningTreeSearch : Grid<Layout>
 {
-	SpanningTreeSearch(const std::vector<bool>& l_cells, int l_width, int l_height) : Grid(l_cells, l_width, l_height)
+	using Grid<Layout>::pack;
+	using Grid<Layout>::unpack;
+	using Grid<Layout>::nodes;
+	SpanningTreeSearch(const std::vector<bool>& l_cells, int l_width, int l_height) : Grid<Layout>(l_cells, l_width, l_height)
 	{
 		setup_grid(*this);
 	}
-	std::array<std::vector<Point>, 2> path_parts;
-	const std::vector<Point>& get_path() const noexcept { return path_parts[0]; }
-	// bool search found a path
-	bool search(Point s, Point g)
+	// bool search found a path, the path from s to g is written to out, out is empty otherwise
+	template <typename Loc>
+	bool search(Point s, Point g, std::vector<Loc>& out)
 	{
+		out.clear();
 		std::array<uint32_t, 2> nodeid{{pack(s), pack(g)}};
 		if (nodes[nodeid[0]].pred == Node::INV || nodes[nodeid[1]].pred == Node::INV)
 			return false;
 		if (nodeid[0] == nodeid[1]) {
 			// zero path case
-			path_parts[0].assign(2, s);
+			out.resize(2);
+			to_loc(out[0], s); to_loc(out[1], s);
 			return true;
 		}
-		path_parts[0].clear(); path_parts[1].clear();
+		// every tree edge costs at least COST_0, which bounds the nodes on both sides of the common ancestor;
+		// the s side is written from the front, the g side backwards from the end, then the gap is closed
+		size_t bound = (static_cast<size_t>(nodes[nodeid[0]].cost) + nodes[nodeid[1]].cost) / COST_0 + 1;
+		out.resize(bound);
+		size_t front = 0, back = bound;
 		while (true) {
 			int progressId = 0;
 			if (auto c0 = nodes[nodeid[0]].cost, c1 = nodes[nodeid[1]].cost; c0 == c1) {
 				// same dist, check if same root
 				if (nodeid[0] == nodeid[1]) {
-					path_parts[0].push_back(unpack(nodeid[progressId]));
+					to_loc(out[front++], unpack(nodeid[0]));
 					break; // found least common ancestor
 				}
-				if (c0 == 0)
+				if (c0 == 0) {
+					out.clear();
 					return false; // tree root's are different, no path
+				}
 			} else if (c1 > c0) {
 				progressId = 1; // nodeid[1] is longer thus process it first
 			}
-			path_parts[progressId].push_back(unpack(nodeid[progressId]));
+			assert(front < back);
+			to_loc(progressId == 0 ? out[front++] : out[--back], unpack(nodeid[progressId]));
 			nodeid[progressId] = nodes[nodeid[progressId]].pred;
 		}
 		// finalise path
-		path_parts[0].insert(path_parts[0].end(), path_parts[1].rbegin(), path_parts[1].rend());
+		std::copy(out.begin() + back, out.end(), out.begin() + front);
+		out.resize(front + (bound - back));
 		return true;
 	}
 };
 
-void flood_fill(Grid& grid, std::pmr::vector<Point>& out, uint32_t origin, std::pmr::memory_resource* res)
+template <typename Layout>
+void flood_fill(Grid<Layout>& grid, std::pmr::vector<Point>& out, uint32_t origin, std::pmr::memory_resource* res)
 {
 	assert(origin < grid.nodes.size() && grid.nodes[origin].pred == Node::INV);
 	out.clear();
@@ -150,13 +288,21 @@ enum class Compass : uint32_t
 	SE = 0b100'000'000 | S | E,
 	SW = 0b001'000'000 | S | W,
 };
-void dijkstra(Grid& grid, uint32_t origin, std::pmr::memory_resource* res)
+// octile distance in COST_0/COST_1 units, consistent for 8N moves without corner cutting
+inline uint32_t octile_h(Point a, Point b) noexcept
+{
+	uint32_t dx = static_cast<uint32_t>(std::abs(a.first - b.first));
+	uint32_t dy = static_cast<uint32_t>(std::abs(a.second - b.second));
+	return dx < dy ? dx * COST_1 + (dy - dx) * COST_0 : dy * COST_1 + (dx - dy) * COST_0;
+}
+template <typename Layout>
+void dijkstra(Grid<Layout>& grid, uint32_t origin, std::pmr::memory_resource* res)
 {
 	// first = dist, second = node-id
 	using node_type = std::pair<uint32_t,uint32_t>;
 	std::priority_queue<node_type, std::pmr::vector<node_type>, std::greater<node_type>> Q(res);
-	auto try_push = [&grid,&Q](uint32_t node, int dx, int dy, uint32_t cost) {
-		uint32_t newNode = static_cast<uint32_t>( static_cast<int>(node) + dy * grid.width + dx );
+	auto try_push = [&grid,&Q](uint32_t node, Point p, int dx, int dy, uint32_t cost) {
+		uint32_t newNode = grid.pack( Point(p.first + dx, p.second + dy) );
 		Node& N = grid.nodes[newNode];
 		if (cost < N.cost) {
 			N.pred = node;
@@ -184,25 +330,26 @@ void dijkstra(Grid& grid, uint32_t origin, std::pmr::memory_resource* res)
 		// 345
 		// 678
 		// N
-		if ( (mask & static_cast<uint32_t>(Compass::N)) == 0 ) try_push(node, 0, -1, cost + COST_0);
+		if ( (mask & static_cast<uint32_t>(Compass::N)) == 0 ) try_push(node, p, 0, -1, cost + COST_0);
 		// E
-		if ( (mask & static_cast<uint32_t>(Compass::E)) == 0 ) try_push(node, 1, 0, cost + COST_0);
+		if ( (mask & static_cast<uint32_t>(Compass::E)) == 0 ) try_push(node, p, 1, 0, cost + COST_0);
 		// S
-		if ( (mask & static_cast<uint32_t>(Compass::S)) == 0 ) try_push(node, 0, 1, cost + COST_0);
+		if ( (mask & static_cast<uint32_t>(Compass::S)) == 0 ) try_push(node, p, 0, 1, cost + COST_0);
 		// W
-		if ( (mask & static_cast<uint32_t>(Compass::W)) == 0 ) try_push(node, -1, 0, cost + COST_0);
+		if ( (mask & static_cast<uint32_t>(Compass::W)) == 0 ) try_push(node, p, -1, 0, cost + COST_0);
 		// NE
-		if ( (mask & static_cast<uint32_t>(Compass::NE)) == 0 ) try_push(node, 1, -1, cost + COST_1);
+		if ( (mask & static_cast<uint32_t>(Compass::NE)) == 0 ) try_push(node, p, 1, -1, cost + COST_1);
 		// NW
-		if ( (mask & static_cast<uint32_t>(Compass::NW)) == 0 ) try_push(node, -1, -1, cost + COST_1);
+		if ( (mask & static_cast<uint32_t>(Compass::NW)) == 0 ) try_push(node, p, -1, -1, cost + COST_1);
 		// SE
-		if ( (mask & static_cast<uint32_t>(Compass::SE)) == 0 ) try_push(node, 1, 1, cost + COST_1);
+		if ( (mask & static_cast<uint32_t>(Compass::SE)) == 0 ) try_push(node, p, 1, 1, cost + COST_1);
 		// SW
-		if ( (mask & static_cast<uint32_t>(Compass::SW)) == 0 ) try_push(node, -1, 1, cost + COST_1);
+		if ( (mask & static_cast<uint32_t>(Compass::SW)) == 0 ) try_push(node, p, -1, 1, cost + COST_1);
 	}
 }
 
-void setup_grid(Grid& grid)
+template <typename Layout>
+void setup_grid(Grid<Layout>& grid)
 {
 	grid.nodes.assign(grid.size(), Node{Node::INV, Node::INV});
 	std::pmr::unsynchronized_pool_resource vector_res;
@@ -0,0 +1,300 @@
+#ifndef OPT_GPPC_BIDIRECTIONAL_SEARCH_HXX
+#define OPT_GPPC_BIDIRECTIONAL_SEARCH_HXX
+
+#include "BaselineSearch.hxx"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <cstdlib>
+
+namespace baseline
+{
+
+using std::uint64_t;
+
+/**
+ * Bidirectional MM search (Holte et al. 2016) on the octile grid.
+ * Each frontier orders its open list by pr(n) = max(g(n) + h(n), 2 g(n)), the direction with the
+ * lower pr is expanded, and search stops once the best meeting cost U <= min(prmin_F, prmin_B).
+ *
+ * g-values of both directions are published into shared atomic arrays tagged with the query
+ * generation, so no per-query clearing is required and, in parallel mode, the backward frontier
+ * runs on a persistent worker thread that meets the forward frontier without locks.
+ */
+template <typename Layout = RowMajorLayout>
+struct BidirectionalSearch : Grid<Layout>
+{
+	using Grid<Layout>::size;
+	using Grid<Layout>::pack;
+	using Grid<Layout>::unpack;
+	using Grid<Layout>::get;
+	static constexpr uint32_t INV = Node::INV;
+	static constexpr uint64_t NO_MEET = std::numeric_limits<uint64_t>::max();
+
+	BidirectionalSearch(const std::vector<bool>& l_cells, int l_width, int l_height, bool l_parallel = false) :
+		 Grid<Layout>(l_cells, l_width, l_height)
+		,parallel(l_parallel)
+		,order(l_parallel ? std::memory_order_seq_cst : std::memory_order_relaxed)
+		,generation(0)
+		,best(NO_MEET)
+		,stop(false)
+	{
+		for (auto& F : frontier) {
+			F.g = std::make_unique<std::atomic<uint64_t>[]>(size());
+			for (size_t i = 0, ie = size(); i < ie; ++i)
+				F.g[i].store(INV, std::memory_order_relaxed);
+			F.pred.assign(size(), Node::NO_PRED);
+		}
+	}
+	~BidirectionalSearch()
+	{
+		if (worker.joinable()) {
+			{
+				std::lock_guard<std::mutex> lock(job_mutex);
+				job = Job::Quit;
+			}
+			job_cv.notify_all();
+			worker.join();
+		}
+	}
+	BidirectionalSearch(const BidirectionalSearch&) = delete;
+	BidirectionalSearch& operator=(const BidirectionalSearch&) = delete;
+
+	// cost of the last path found in COST_0/COST_1 units
+	uint32_t get_cost() const noexcept { return path_cost; }
+	// nodes expanded by the last search, both directions
+	uint64_t get_expansions() const noexcept { return frontier[0].expansions + frontier[1].expansions; }
+	// bool search found a path, the path from s to g is written to out, out is empty otherwise
+	template <typename Loc>
+	bool search(Point s, Point g, std::vector<Loc>& out)
+	{
+		out.clear();
+		frontier[0].expansions = frontier[1].expansions = 0;
+		if (!get(s) || !get(g))
+			return false;
+		if (s == g) {
+			// zero path case
+			out.resize(2);
+			to_loc(out[0], s); to_loc(out[1], s);
+			path_cost = 0;
+			return true;
+		}
+		next_generation();
+		best.store(NO_MEET, std::memory_order_relaxed);
+		stop.store(false, std::memory_order_relaxed);
+		start_frontier(0, s, g);
+		start_frontier(1, g, s);
+		if (parallel) {
+			run_parallel();
+		} else {
+			while (true) {
+				uint64_t pr0, pr1;
+				if (!top(0, pr0) || !top(1, pr1))
+					break; // one side exhausted its component, U is final
+				if (meet_cost() <= std::min(pr0, pr1))
+					break;
+				expand(pr0 <= pr1 ? 0 : 1);
+			}
+		}
+		uint64_t meet = best.load(std::memory_order_acquire);
+		if (meet == NO_MEET)
+			return false;
+		finalise_path(static_cast<uint32_t>(meet), out);
+		path_cost = static_cast<uint32_t>(meet >> 32);
+		return true;
+	}
+
+private:
+	struct OpenNode
+	{
+		uint64_t pr;
+		uint32_t g;
+		uint32_t id;
+		bool operator>(const OpenNode& o) const noexcept
+		{
+			// tie-break towards deeper nodes
+			return pr != o.pr ? pr > o.pr : g < o.g;
+		}
+	};
+	struct Frontier
+	{
+		std::unique_ptr<std::atomic<uint64_t>[]> g; // generation << 32 | g-value
+		std::vector<uint32_t> pred;
+		std::priority_queue<OpenNode, std::vector<OpenNode>, std::greater<OpenNode>> open;
+		std::atomic<uint64_t> prmin;
+		Point target;
+		uint64_t expansions; // only touched by the thread running this frontier
+	};
+	enum class Job { Idle, Run, Done, Quit };
+
+	uint32_t load_g(int dir, uint32_t id) const noexcept
+	{
+		uint64_t v = frontier[dir].g[id].load(order);
+		return static_cast<uint32_t>(v >> 32) == generation ? static_cast<uint32_t>(v) : INV;
+	}
+	void store_g(int dir, uint32_t id, uint32_t g) noexcept
+	{
+		frontier[dir].g[id].store(static_cast<uint64_t>(generation) << 32 | g, order);
+	}
+	uint32_t meet_cost() const noexcept
+	{
+		return static_cast<uint32_t>(best.load(std::memory_order_acquire) >> 32);
+	}
+	void next_generation()
+	{
+		if (++generation == 0) {
+			// wrapped, stale tags could alias the new generation
+			for (auto& F : frontier)
+				for (size_t i = 0, ie = size(); i < ie; ++i)
+					F.g[i].store(INV, std::memory_order_relaxed);
+			generation = 1;
+		}
+	}
+	void start_frontier(int dir, Point origin, Point target)
+	{
+		Frontier& F = frontier[dir];
+		while (!F.open.empty())
+			F.open.pop();
+		F.target = target;
+		uint32_t id = pack(origin);
+		F.pred[id] = Node::NO_PRED;
+		store_g(dir, id, 0);
+		uint64_t pr = octile_h(origin, target);
+		F.open.push(OpenNode{pr, 0, id});
+		F.prmin.store(pr, std::memory_order_relaxed);
+	}
+	// offer U = g_F + g_B through id, lock-free min over the packed (cost, node) pair
+	void offer_meet(uint32_t cost, uint32_t id) noexcept
+	{
+		uint64_t cand = static_cast<uint64_t>(cost) << 32 | id;
+		uint64_t cur = best.load(std::memory_order_acquire);
+		while (cand < cur && !best.compare_exchange_weak(cur, cand, std::memory_order_acq_rel))
+		{ }
+	}
+	// drop stale entries, return false if open list is empty
+	bool top(int dir, uint64_t& pr)
+	{
+		auto& Q = frontier[dir].open;
+		while (!Q.empty()) {
+			const OpenNode& n = Q.top();
+			if (n.g == load_g(dir, n.id)) {
+				pr = n.pr;
+				return true;
+			}
+			Q.pop();
+		}
+		return false;
+	}
+	void expand(int dir)
+	{
+		Frontier& F = frontier[dir];
+		OpenNode n = F.open.top(); F.open.pop();
+		F.expansions++;
+		Point p = unpack(n.id);
+		uint32_t mask = 0;
+		for (int i = 0, dy = -1; dy < 2; dy++)
+		for (int dx = -1; dx < 2; dx++) {
+			mask |= static_cast<uint32_t>(get( Point(p.first + dx, p.second + dy) )) << i++;
+		}
+		mask = ~mask; // 1 = non-trav, 0 = trav
+		auto try_push = [this,dir,&F,&n,p](int dx, int dy, uint32_t cost) {
+			uint32_t id = pack( Point(p.first + dx, p.second + dy) );
+			uint32_t g = n.g + cost;
+			if (g >= load_g(dir, id))
+				return;
+			F.pred[id] = n.id;
+			store_g(dir, id, g);
+			if (uint32_t other = load_g(dir ^ 1, id); other != INV)
+				offer_meet(g + other, id);
+			uint64_t f = static_cast<uint64_t>(g) + octile_h(Point(p.first + dx, p.second + dy), F.target);
+			if (f >= meet_cost())
+				return; // cannot improve U
+			F.open.push(OpenNode{std::max(f, 2 * static_cast<uint64_t>(g)), g, id});
+		};
+		if ( (mask & static_cast<uint32_t>(Compass::N)) == 0 ) try_push(0, -1, COST_0);
+		if ( (mask & static_cast<uint32_t>(Compass::E)) == 0 ) try_push(1, 0, COST_0);
+		if ( (mask & static_cast<uint32_t>(Compass::S)) == 0 ) try_push(0, 1, COST_0);
+		if ( (mask & static_cast<uint32_t>(Compass::W)) == 0 ) try_push(-1, 0, COST_0);
+		if ( (mask & static_cast<uint32_t>(Compass::NE)) == 0 ) try_push(1, -1, COST_1);
+		if ( (mask & static_cast<uint32_t>(Compass::NW)) == 0 ) try_push(-1, -1, COST_1);
+		if ( (mask & static_cast<uint32_t>(Compass::SE)) == 0 ) try_push(1, 1, COST_1);
+		if ( (mask & static_cast<uint32_t>(Compass::SW)) == 0 ) try_push(-1, 1, COST_1);
+	}
+	// search loop of one frontier in parallel mode, the published prmin is the pr of the node
+	// currently being expanded so it stays a lower bound while its successors are in flight
+	void run_frontier(int dir)
+	{
+		Frontier& F = frontier[dir];
+		while (!stop.load(std::memory_order_acquire)) {
+			uint64_t pr;
+			if (!top(dir, pr))
+				break;
+			F.prmin.store(pr, std::memory_order_seq_cst);
+			if (meet_cost() <= std::min(pr, frontier[dir ^ 1].prmin.load(std::memory_order_seq_cst)))
+				break;
+			expand(dir);
+		}
+		stop.store(true, std::memory_order_release);
+	}
+	void run_parallel()
+	{
+		if (!worker.joinable()) {
+			worker = std::thread([this] {
+				std::unique_lock<std::mutex> lock(job_mutex);
+				while (true) {
+					job_cv.wait(lock, [this] { return job == Job::Run || job == Job::Quit; });
+					if (job == Job::Quit)
+						return;
+					lock.unlock();
+					run_frontier(1);
+					lock.lock();
+					job = Job::Done;
+					job_cv.notify_all();
+				}
+			});
+		}
+		{
+			std::lock_guard<std::mutex> lock(job_mutex);
+			job = Job::Run;
+		}
+		job_cv.notify_all();
+		run_frontier(0);
+		std::unique_lock<std::mutex> lock(job_mutex);
+		job_cv.wait(lock, [this] { return job == Job::Done; });
+		job = Job::Idle;
+	}
+	// every edge costs at least COST_0, so g bounds the length of each pred chain; the forward chain
+	// is written backwards ending at its bound, the backward chain follows it, then both are shifted down
+	template <typename Loc>
+	void finalise_path(uint32_t meet, std::vector<Loc>& out)
+	{
+		size_t mid = load_g(0, meet) / COST_0 + 1;
+		out.resize(mid + load_g(1, meet) / COST_0);
+		size_t front = mid, back = mid;
+		for (uint32_t id = meet; id != Node::NO_PRED; id = frontier[0].pred[id])
+			to_loc(out[--front], unpack(id));
+		for (uint32_t id = frontier[1].pred[meet]; id != Node::NO_PRED; id = frontier[1].pred[id])
+			to_loc(out[back++], unpack(id));
+		out.resize(back);
+		out.erase(out.begin(), out.begin() + front);
+	}
+
+	bool parallel;
+	// g store/load pairs of the two frontiers must be sequentially consistent so at least one side sees the meet
+	std::memory_order order;
+	uint32_t generation;
+	std::array<Frontier, 2> frontier;
+	std::atomic<uint64_t> best; // U << 32 | meeting node
+	std::atomic<bool> stop;
+	uint32_t path_cost = 0;
+	std::thread worker;
+	std::mutex job_mutex;
+	std::condition_variable job_cv;
+	Job job = Job::Idle;
+};
+
+} // namespace baseline
+
+#endif
@@ -21,7 +21,213 @@ SOFTWARE.
 */
 
 #include "Entry.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
 #include "BaselineSearch.hxx"
+#include "BidirectionalSearch.hxx"
+#include "SparseAStarSearch.hxx"
+#include "WeightedAStarSearch.hxx"
+#include "TiledMapStore.hxx"
+#include "PathCompaction.hxx"
+
+namespace {
+
+/**
+ * Search engine used by the example, chosen in `PrepareForSearch` through the environment variable
+ * `BASELINE_ENGINE`:
+ *   spanning-tree (default)  walk the precomputed spanning tree, fast but suboptimal
+ *   bidirectional            optimal bidirectional MM search
+ *   bidirectional-parallel   as above, backward frontier expanded on a second thread
+ *   weighted-astar           weighted A*, path cost at most BASELINE_WEIGHT times optimal
+ *   out-of-core              A* with sparse state over a memory-mapped tile store of the map,
+ *                            always used for maps with a side longer than INT16_MAX
+ */
+enum class Engine
+{
+  SpanningTree,
+  Bidirectional,
+  BidirectionalParallel,
+  WeightedAStar,
+  OutOfCore,
+};
+
+Engine GetEngine(int width, int height) {
+  if (width > INT16_MAX || height > INT16_MAX)
+    return Engine::OutOfCore;
+  const char* name = std::getenv("BASELINE_ENGINE");
+  if (name == nullptr || std::strcmp(name, "spanning-tree") == 0)
+    return Engine::SpanningTree;
+  if (std::strcmp(name, "out-of-core") == 0)
+    return Engine::OutOfCore;
+  if (std::strcmp(name, "bidirectional") == 0)
+    return Engine::Bidirectional;
+  if (std::strcmp(name, "bidirectional-parallel") == 0)
+    return Engine::BidirectionalParallel;
+  if (std::strcmp(name, "weighted-astar") == 0)
+    return Engine::WeightedAStar;
+  std::fprintf(stderr, "Unknown BASELINE_ENGINE %s, using spanning-tree\n", name);
+  return Engine::SpanningTree;
+}
+
+/**
+ * Suboptimality bound w >= 1 of the weighted-astar engine, `BASELINE_WEIGHT` (default 1, i.e. optimal).
+ */
+double GetWeight() {
+  const char* value = std::getenv("BASELINE_WEIGHT");
+  if (value == nullptr)
+    return 1.0;
+  char* end;
+  double w = std::strtod(value, &end);
+  if (end == value || *end != '\0' || !(w >= 1.0)) {
+    std::fprintf(stderr, "Invalid BASELINE_WEIGHT %s, using 1\n", value);
+    return 1.0;
+  }
+  return w;
+}
+
+/**
+ * Cell layout of the engine's grid, chosen through `BASELINE_LAYOUT`:
+ *   row-major (default)  id = y * width + x
+ *   tiled                8x8 blocked tiles, see baseline::TiledLayout
+ */
+enum class Layout
+{
+  RowMajor,
+  Tiled,
+};
+
+Layout GetLayout() {
+  const char* name = std::getenv("BASELINE_LAYOUT");
+  if (name == nullptr || std::strcmp(name, "row-major") == 0)
+    return Layout::RowMajor;
+  if (std::strcmp(name, "tiled") == 0)
+    return Layout::Tiled;
+  std::fprintf(stderr, "Unknown BASELINE_LAYOUT %s, using row-major\n", name);
+  return Layout::RowMajor;
+}
+
+/**
+ * Queries between releases of the out-of-core engine's resident tiles, `BASELINE_TILE_RELEASE`
+ * (default 0, eviction is left to the kernel).  A release runs inside the timed query that triggers it.
+ */
+unsigned long long GetTileRelease() {
+  const char* value = std::getenv("BASELINE_TILE_RELEASE");
+  return value == nullptr ? 0 : std::strtoull(value, nullptr, 10);
+}
+
+std::string TileStoreFile(const std::string &filename) {
+  return filename + ".tiles";
+}
+
+// write the store if `-pre` was not run for this map, or rewrite it if it was written for another
+// map sharing the basename or for an earlier version of this map
+bool OpenTileStore(baseline::TiledMapStore &store, const std::string &fname, const std::vector<bool> &bits, int width, int height) {
+  if (store.open(fname) && store.width == static_cast<std::uint32_t>(width) && store.height == static_cast<std::uint32_t>(height)
+      && store.map_checksum == baseline::TiledMapStore::checksum(bits))
+    return true;
+  store.close();
+  return baseline::TiledMapStore::write(fname, bits, width, height) && store.open(fname);
+}
+
+// engines write the path straight into `path`, reusing its capacity between queries
+template <typename Engine, typename Loc>
+void SearchPath(Engine &engine, Loc s, Loc g, std::vector<Loc> &path) {
+  engine.search(baseline::Point(s.x, s.y), baseline::Point(g.x, g.y), path);
+}
+
+/**
+ * Paths are reduced to their turning points unless `BASELINE_COMPACT_PATH=0`.
+ */
+bool GetCompactPath() {
+  const char* value = std::getenv("BASELINE_COMPACT_PATH");
+  return value == nullptr || std::strcmp(value, "0") != 0;
+}
+
+// engines providing `get_expansions()` report the nodes expanded by their last search
+template <typename Engine, typename = void>
+struct CountsExpansions : std::false_type { };
+template <typename Engine>
+struct CountsExpansions<Engine, std::void_t<decltype(std::declval<const Engine&>().get_expansions())>> : std::true_type { };
+
+struct SearchData
+{
+  virtual ~SearchData() = default;
+  bool compact = true;
+  virtual void Search(xyLoc s, xyLoc g, std::vector<xyLoc> &path) = 0;
+  virtual void Search(xyLocWide s, xyLocWide g, std::vector<xyLocWide> &path) = 0;
+  virtual long long Expansions() const = 0;
+};
+
+template <typename Engine>
+struct EngineData : SearchData
+{
+  template <typename... Args>
+  EngineData(Args&&... args) : engine(std::forward<Args>(args)...) { }
+
+  void Search(xyLoc s, xyLoc g, std::vector<xyLoc> &path) override {
+    SearchPath(engine, s, g, path);
+  }
+  void Search(xyLocWide s, xyLocWide g, std::vector<xyLocWide> &path) override {
+    SearchPath(engine, s, g, path);
+  }
+  long long Expansions() const override {
+    if constexpr (CountsExpansions<Engine>::value)
+      return static_cast<long long>(engine.get_expansions());
+    else
+      return -1;
+  }
+
+  Engine engine;
+};
+
+// the tile store must outlive the engine reading it
+struct OutOfCoreData : SearchData
+{
+  OutOfCoreData() : engine(store), release_every(GetTileRelease()) { }
+
+  void Search(xyLoc s, xyLoc g, std::vector<xyLoc> &path) override {
+    SearchPath(engine, s, g, path);
+    QueryDone();
+  }
+  void Search(xyLocWide s, xyLocWide g, std::vector<xyLocWide> &path) override {
+    SearchPath(engine, s, g, path);
+    QueryDone();
+  }
+  // resident tiles are bounded by those touched since the last release, not only by memory pressure
+  void QueryDone() {
+    if (release_every != 0 && ++queries % release_every == 0)
+      store.release();
+  }
+  long long Expansions() const override {
+    return static_cast<long long>(engine.get_expansions());
+  }
+
+  baseline::TiledMapStore store;
+  baseline::SparseAStarSearch<baseline::TiledMapStore> engine;
+  unsigned long long release_every;
+  unsigned long long queries = 0;
+};
+
+template <typename GridLayout>
+SearchData *MakeSearch(Engine engine, const std::vector<bool> &bits, int width, int height) {
+  switch (engine) {
+  case Engine::Bidirectional:
+  case Engine::BidirectionalParallel:
+    return new EngineData<baseline::BidirectionalSearch<GridLayout>>(bits, width, height,
+        engine == Engine::BidirectionalParallel);
+  case Engine::WeightedAStar:
+    return new EngineData<baseline::WeightedAStarSearch<GridLayout>>(bits, width, height, GetWeight());
+  case Engine::SpanningTree:
+  default:
+    return new EngineData<baseline::SpanningTreeSearch<GridLayout>>(bits, width, height);
+  }
+}
+
+} // namespace
 
 
 /**
@@ -32,6 +238,9 @@ SOFTWARE.
  * Called with command below:
  * ./run -pre file.map
  * 
+ * Under `./run -pre-all`, the environment variable GPPC_PREPROCESS_THREADS gives the number of threads
+ * it may use (more than 1 only if config.json sets multi_cpu_preprocessing).
+ * 
  * @param[in] bits Array of 2D table.  (0,0) is located at top-left corner.  bits.size() = height * width
  *                 Packed as 1D array, row-by-ray, i.e. first width bool's give row y=0, next width y=1
  *                 bits[i] returns `true` if (x,y) is traversable, `false` otherwise
@@ -39,7 +248,13 @@ SOFTWARE.
  * @param[in] height Give the map's height
  * @param[in] filename The filename you write the preprocessing data to.  Open in write mode.
  */
-void PreprocessMap(const std::vector<bool> &bits, int width, int height, const std::string &filename) {}
+void PreprocessMap(const std::vector<bool> &bits, int width, int height, const std::string &filename) {
+  if (GetEngine(width, height) == Engine::OutOfCore
+      && !baseline::TiledMapStore::write(TileStoreFile(filename), bits, width, height)) {
+    std::fprintf(stderr, "Cannot create tile store %s\n", TileStoreFile(filename).c_str());
+    std::exit(1);
+  }
+}
 
 /**
  * User code used to setup search before queries.  Can also load pre-processing data from file to speed load.
@@ -59,8 +274,22 @@ void PreprocessMap(const std::vector<bool> &bits, int width, int height, const s
  * @returns Pointer to data-structure used for search.  Memory should be stored on heap, not stack.
  */
 void *PrepareForSearch(const std::vector<bool> &bits, int width, int height, const std::string &filename) {
-  auto* STS = new baseline::SpanningTreeSearch(bits, width, height);
-  return STS;
+  Engine engine = GetEngine(width, height);
+  SearchData* data;
+  if (engine == Engine::OutOfCore) {
+    auto* ooc = new OutOfCoreData;
+    if (!OpenTileStore(ooc->store, TileStoreFile(filename), bits, width, height)) {
+      std::fprintf(stderr, "Cannot create tile store %s\n", TileStoreFile(filename).c_str());
+      std::exit(1);
+    }
+    data = ooc;
+  } else if (GetLayout() == Layout::Tiled) {
+    data = MakeSearch<baseline::TiledLayout<>>(engine, bits, width, height);
+  } else {
+    data = MakeSearch<baseline::RowMajorLayout>(engine, bits, width, height);
+  }
+  data->compact = GetCompactPath();
+  return data;
 }
 
 /**
@@ -83,18 +312,37 @@ void *PrepareForSearch(const std::vector<bool> &bits, int width, int height, con
  *          if `false` then `GetPath` will be called again until search is complete.
  */
 bool GetPath(void *data, xyLoc s, xyLoc g, std::vector<xyLoc> &path) {
-  auto* STS = static_cast<baseline::SpanningTreeSearch*>(data);
+  auto* SD = static_cast<SearchData*>(data);
   path.clear();
-  bool exists = STS->search(baseline::Point(s.x, s.y), baseline::Point(g.x, g.y));
-  if (!exists)
-    return true;
-  for (auto p : STS->get_path()) {
-    xyLoc L; L.x = p.first; L.y = p.second;
-    path.push_back(L);
-  }
+  SD->Search(s, g, path);
+  if (SD->compact)
+    baseline::compact_path(path);
+  return true;
+}
+
+/**
+ * Same as `GetPath` with 32-bit coordinates, called instead of `GetPath` for maps with
+ * width or height greater than INT16_MAX.
+ */
+bool GetPathWide(void *data, xyLocWide s, xyLocWide g, std::vector<xyLocWide> &path) {
+  auto* SD = static_cast<SearchData*>(data);
+  path.clear();
+  SD->Search(s, g, path);
+  if (SD->compact)
+    baseline::compact_path(path);
   return true;
 }
 
+/**
+ * Optional statistic reported in result.csv, called after `GetPath`/`GetPathWide`.
+ * 
+ * @param[in] data Pointer to data returned from `PrepareForSearch`.
+ * @returns the number of nodes expanded by the last `GetPath`/`GetPathWide` call, or -1 if not counted.
+ */
+long long GetExpansions(void *data) {
+  return static_cast<SearchData*>(data)->Expansions();
+}
+
 /**
  * The algorithm name.  Please update std::string and ensure name is immutable.
  * 
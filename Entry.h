@@ -30,6 +30,7 @@ SOFTWARE.
 #include "GPPC.h"
 
 typedef GPPC::xyLoc xyLoc;
+typedef GPPC::xyLocWide xyLocWide;
 
 void PreprocessMap(const std::vector<bool> &bits, int width, int height, const std::string &filename);
 void *PrepareForSearch(const std::vector<bool> &bits, int width, int height, const std::string &filename);
@@ -49,6 +50,18 @@ e.g.:
 */
 bool GetPath(void *data, xyLoc s, xyLoc g, std::vector<xyLoc> &path);
 
+/*
+same as GetPath, used instead of it when the map width or height exceeds INT16_MAX;
+optional, without it such queries get an empty path
+*/
+bool GetPathWide(void *data, xyLocWide s, xyLocWide g, std::vector<xyLocWide> &path);
+
+/*
+nodes expanded by the last GetPath/GetPathWide call, reported in result.csv,
+return -1 if the search does not count them; optional, without it result.csv reports -1
+*/
+long long GetExpansions(void *data);
+
 std::string GetName();
 
 #endif // GPPC_ENTRY_H
@@ -30,6 +30,11 @@ namespace GPPC {
     int16_t x;
     int16_t y;
   };
+  // coordinates for maps with a side longer than INT16_MAX
+  struct xyLocWide {
+    int32_t x;
+    int32_t y;
+  };
 }
 
 #endif // GPPC_GPPC_H
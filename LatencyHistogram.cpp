@@ -0,0 +1,95 @@
+/*
+Copyright (c) 2023 Grid-based Path Planning Competition and Contributors <https://gppc.search-conference.org/>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <string>
+#include "LatencyHistogram.h"
+
+namespace {
+constexpr unsigned HALF = 1u << (LatencyHistogram::SUB_BITS - 1);
+constexpr unsigned BUCKETS = (64 - LatencyHistogram::SUB_BITS + 2) * HALF;
+}
+
+LatencyHistogram::LatencyHistogram()
+	:counts(BUCKETS, 0), count(0), min(UINT64_MAX), max(0), sum(0)
+{ }
+
+unsigned LatencyHistogram::Index(std::uint64_t v)
+{
+	if (v < (std::uint64_t{1} << SUB_BITS))
+		return static_cast<unsigned>(v);
+	unsigned magnitude = 63 - __builtin_clzll(v) - (SUB_BITS - 1);
+	return magnitude * HALF + static_cast<unsigned>(v >> magnitude);
+}
+
+std::uint64_t LatencyHistogram::HighestEquivalent(unsigned index)
+{
+	if (index < (1u << SUB_BITS))
+		return index;
+	unsigned magnitude = index / HALF - 1;
+	std::uint64_t mantissa = index - magnitude * HALF;
+	return ((mantissa + 1) << magnitude) - 1;
+}
+
+void LatencyHistogram::Record(std::uint64_t v)
+{
+	counts[Index(v)] += 1;
+	count += 1;
+	min = std::min(min, v);
+	max = std::max(max, v);
+	sum += v;
+}
+
+std::uint64_t LatencyHistogram::GetPercentile(double p) const
+{
+	if (count == 0)
+		return 0;
+	std::uint64_t rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(p / 100.0 * count)));
+	std::uint64_t seen = 0;
+	for (unsigned i = 0; i < counts.size(); i++) {
+		seen += counts[i];
+		if (seen >= rank)
+			return std::min(HighestEquivalent(i), max);
+	}
+	return max;
+}
+
+bool WriteLatencyReport(const char *fname, const std::map<int, LatencyHistogram> &buckets, const LatencyHistogram &all)
+{
+	FILE *f = std::fopen(fname, "w");
+	if (f == nullptr)
+		return false;
+	std::fprintf(f, "bucket,count,min,mean,p50,p90,p99,p99.9,max\n");
+	auto row = [f] (const char *name, const LatencyHistogram &h) {
+		std::fprintf(f, "%s,%llu,%llu,%.1f,%llu,%llu,%llu,%llu,%llu\n", name,
+		             static_cast<unsigned long long>(h.GetCount()), static_cast<unsigned long long>(h.GetMin()),
+		             h.GetMean(), static_cast<unsigned long long>(h.GetPercentile(50)),
+		             static_cast<unsigned long long>(h.GetPercentile(90)), static_cast<unsigned long long>(h.GetPercentile(99)),
+		             static_cast<unsigned long long>(h.GetPercentile(99.9)), static_cast<unsigned long long>(h.GetMax()));
+	};
+	for (const auto &it : buckets)
+		row(std::to_string(it.first).c_str(), it.second);
+	row("all", all);
+	return std::fclose(f) == 0;
+}
@@ -0,0 +1,63 @@
+/*
+Copyright (c) 2023 Grid-based Path Planning Competition and Contributors <https://gppc.search-conference.org/>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef GPPC_LATENCYHISTOGRAM_H
+#define GPPC_LATENCYHISTOGRAM_H
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+/**
+ * HDR-style latency histogram.
+ * Values below 2^SUB_BITS are counted exactly, larger values in log2 buckets each split into
+ * 2^(SUB_BITS-1) linear sub-buckets, i.e. within ~3% relative error over the whole uint64 range
+ * in a fixed 15 KiB table.
+ */
+class LatencyHistogram {
+public:
+	static constexpr unsigned SUB_BITS = 6;
+
+	LatencyHistogram();
+	void Record(std::uint64_t v);
+	std::uint64_t GetCount() const { return count; }
+	std::uint64_t GetMin() const { return count == 0 ? 0 : min; }
+	std::uint64_t GetMax() const { return max; }
+	double GetMean() const { return count == 0 ? 0 : static_cast<double>(sum) / count; }
+	// highest value equivalent to the p-th percentile sample, p in [0,100]
+	std::uint64_t GetPercentile(double p) const;
+
+private:
+	static unsigned Index(std::uint64_t v);
+	static std::uint64_t HighestEquivalent(unsigned index);
+
+	std::vector<std::uint64_t> counts;
+	std::uint64_t count;
+	std::uint64_t min;
+	std::uint64_t max;
+	std::uint64_t sum;
+};
+
+// write one csv row of summary statistics per scenario bucket, plus an "all" row over every bucket
+bool WriteLatencyReport(const char *fname, const std::map<int, LatencyHistogram> &buckets, const LatencyHistogram &all);
+
+#endif // GPPC_LATENCYHISTOGRAM_H
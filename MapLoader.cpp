@@ -0,0 +1,48 @@
+/*
+Copyright (c) 2023 Grid-based Path Planning Competition and Contributors <https://gppc.search-conference.org/>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstdio>
+#include <cctype>
+#include "MapLoader.h"
+
+void LoadMap(const char *fname, std::vector<bool> &map, int &width, int &height)
+{
+	FILE *f;
+	f = std::fopen(fname, "r");
+	if (f)
+	{
+		std::fscanf(f, "type octile\nheight %d\nwidth %d\nmap\n", &height, &width);
+		map.resize(static_cast<size_t>(height)*width);
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				char c;
+				do {
+					std::fscanf(f, "%c", &c);
+				} while (std::isspace(c));
+				map[static_cast<size_t>(y)*width+x] = (c == '.' || c == 'G' || c == 'S');
+			}
+		}
+		std::fclose(f);
+	}
+}
@@ -0,0 +1,51 @@
+#ifndef OPT_GPPC_PATH_COMPACTION_HXX
+#define OPT_GPPC_PATH_COMPACTION_HXX
+
+#include <vector>
+#include <cstdlib>
+#include <cstddef>
+
+namespace baseline
+{
+
+namespace details
+{
+// unit direction of segment a-b, false if a-b is not a cardinal or ordinal line
+template <typename Loc>
+inline bool segment_dir(const Loc& a, const Loc& b, int& dx, int& dy) noexcept
+{
+	int ux = static_cast<int>(b.x) - static_cast<int>(a.x);
+	int uy = static_cast<int>(b.y) - static_cast<int>(a.y);
+	dx = (ux > 0) - (ux < 0);
+	dy = (uy > 0) - (uy < 0);
+	return ux == 0 || uy == 0 || std::abs(ux) == std::abs(uy);
+}
+} // namespace details
+
+/**
+ * Reduce path to its turning points, in place.
+ * Consecutive segments continuing in the same cardinal or ordinal direction are merged, the merged
+ * segment covers exactly the cells of the segments it replaces so a valid path stays valid and keeps
+ * its length.  Segments that are not straight lines are never merged.
+ * Works with any location type with x and y members, paths with fewer than 3 points are unchanged.
+ */
+template <typename Loc>
+void compact_path(std::vector<Loc>& path) noexcept
+{
+	if (path.size() < 3)
+		return;
+	std::size_t last = 0; // path[last] is the most recent turning point kept
+	for (std::size_t i = 1, ie = path.size() - 1; i < ie; ++i) {
+		int ax, ay, bx, by;
+		bool straight = details::segment_dir(path[last], path[i], ax, ay)
+		             && details::segment_dir(path[i], path[i+1], bx, by);
+		if (!straight || ax != bx || ay != by)
+			path[++last] = path[i];
+	}
+	path[++last] = path.back();
+	path.resize(last + 1);
+}
+
+} // namespace baseline
+
+#endif
@@ -0,0 +1,364 @@
+/*
+Copyright (c) 2023 Grid-based Path Planning Competition and Contributors <https://gppc.search-conference.org/>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cinttypes>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <thread>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "PreprocessDriver.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct OutputFile {
+	std::string name; // relative to the datafile's directory
+	std::uint64_t size;
+	std::uint64_t checksum;
+};
+
+// what a map's outputs were produced from, and the outputs themselves
+struct Manifest {
+	std::uint64_t map = 0;
+	std::uint64_t producer = 0;
+	std::uint64_t exe = 0; // 0 unless the executable is checked
+	std::uint64_t env = 0;
+	std::vector<OutputFile> files;
+};
+
+struct Job {
+	std::string mapfile;
+	std::string datafile;
+	// PreprocessMap writes here, so its contents are exactly what this map's child created
+	std::string staging;
+	Manifest manifest;
+	Manifest previous;
+	std::uint64_t mapSize;
+	std::chrono::steady_clock::time_point start;
+};
+
+constexpr std::uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+
+std::uint64_t Fnv(std::uint64_t sum, const unsigned char *p, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		sum = (sum ^ p[i]) * 0x100000001b3ull;
+	return sum;
+}
+
+// 64-bit FNV-1a of a file's contents
+bool Checksum(const std::string &fname, std::uint64_t &sum)
+{
+	FILE *f = std::fopen(fname.c_str(), "rb");
+	if (f == nullptr)
+		return false;
+	sum = FNV_OFFSET;
+	std::vector<unsigned char> buf(1 << 16);
+	size_t n;
+	while ((n = std::fread(buf.data(), 1, buf.size(), f)) != 0)
+		sum = Fnv(sum, buf.data(), n);
+	bool ok = !std::ferror(f);
+	std::fclose(f);
+	return ok;
+}
+
+// checksum of the sorted NAME=value pairs of environment variables starting with one of prefixes
+std::uint64_t EnvChecksum(const std::vector<std::string> &prefixes)
+{
+	std::vector<std::string> vars;
+	for (char **e = environ; *e != nullptr; e++) {
+		for (const auto &p : prefixes) {
+			if (std::strncmp(*e, p.c_str(), p.size()) == 0) {
+				vars.push_back(*e);
+				break;
+			}
+		}
+	}
+	std::sort(vars.begin(), vars.end());
+	std::uint64_t sum = FNV_OFFSET;
+	for (const auto &v : vars)
+		sum = Fnv(sum, reinterpret_cast<const unsigned char*>(v.c_str()), v.size() + 1);
+	return sum;
+}
+
+std::string ManifestFile(const std::string &datafile)
+{
+	return datafile + ".manifest";
+}
+
+bool ReadManifest(const std::string &datafile, Manifest &m)
+{
+	std::ifstream in(ManifestFile(datafile));
+	std::string map, producer, exe, env;
+	if (!(in >> map >> std::hex >> m.map >> producer >> m.producer >> exe >> m.exe >> env >> m.env)
+	    || map != "map" || producer != "producer" || exe != "exe" || env != "env")
+		return false;
+	OutputFile o;
+	while (in >> std::dec >> o.size >> std::hex >> o.checksum >> o.name)
+		m.files.push_back(o);
+	return in.eof();
+}
+
+bool WriteManifest(const std::string &datafile, const Manifest &m)
+{
+	FILE *f = std::fopen(ManifestFile(datafile).c_str(), "w");
+	if (f == nullptr)
+		return false;
+	std::fprintf(f, "map %" PRIx64 "\nproducer %" PRIx64 "\nexe %" PRIx64 "\nenv %" PRIx64 "\n",
+	             m.map, m.producer, m.exe, m.env);
+	for (const auto &o : m.files)
+		std::fprintf(f, "%" PRIu64 " %" PRIx64 " %s\n", o.size, o.checksum, o.name.c_str());
+	return std::fclose(f) == 0;
+}
+
+// the manifest matches map, producer, executable and environment, and every output it lists is unchanged
+bool UpToDate(const std::string &datafile, const Manifest &expected, Manifest &recorded, std::uint64_t &bytes)
+{
+	if (!ReadManifest(datafile, recorded) || recorded.map != expected.map
+	    || recorded.producer != expected.producer || recorded.exe != expected.exe || recorded.env != expected.env)
+		return false;
+	fs::path dir = fs::path(datafile).parent_path();
+	bytes = 0;
+	for (const auto &o : recorded.files) {
+		std::uint64_t sum;
+		if (!Checksum((dir / o.name).string(), sum) || sum != o.checksum)
+			return false;
+		bytes += o.size;
+	}
+	return true;
+}
+
+// replace the outputs listed in the previous manifest by the files staged by the child,
+// returns false if a staged file cannot be moved
+bool CommitOutputs(Job &job, std::uint64_t &bytes)
+{
+	fs::path dir = fs::path(job.datafile).parent_path();
+	std::error_code ec;
+	for (const auto &o : job.previous.files)
+		fs::remove(dir / o.name, ec);
+	std::vector<fs::path> staged;
+	for (const auto &e : fs::directory_iterator(job.staging, ec)) {
+		if (e.is_regular_file())
+			staged.push_back(e.path());
+	}
+	std::sort(staged.begin(), staged.end());
+	bool ok = true;
+	bytes = 0;
+	for (const auto &p : staged) {
+		OutputFile o;
+		o.name = p.filename().string();
+		if (!Checksum(p.string(), o.checksum)) {
+			ok = false;
+			continue;
+		}
+		o.size = fs::file_size(p, ec);
+		fs::rename(p, dir / o.name, ec);
+		if (ec) {
+			ok = false;
+			continue;
+		}
+		bytes += o.size;
+		job.manifest.files.push_back(o);
+	}
+	fs::remove_all(job.staging, ec);
+	return WriteManifest(job.datafile, job.manifest) && ok;
+}
+
+void Report(FILE *report, const std::string &mapfile, const char *status, double seconds, std::uint64_t bytes, long rss)
+{
+	std::fprintf(report, "%s,%s,%.3f,%" PRIu64 ",%ld\n", mapfile.c_str(), status, seconds, bytes, rss);
+	std::fflush(report);
+}
+
+pid_t Launch(const Job &job, const PreprocessFunction &preprocess, const PreprocessOptions &opt, unsigned threads)
+{
+	std::fflush(nullptr);
+	pid_t pid = ::fork();
+	if (pid != 0)
+		return pid;
+	// child: keep the report on stdout clean of anything PreprocessMap prints
+	::dup2(STDERR_FILENO, STDOUT_FILENO);
+	if (opt.memoryCap != 0) {
+		rlimit limit;
+		limit.rlim_cur = limit.rlim_max = opt.memoryCap;
+		::setrlimit(RLIMIT_AS, &limit);
+	}
+	::setenv("GPPC_PREPROCESS_THREADS", std::to_string(threads).c_str(), 1);
+	preprocess(job.mapfile, (fs::path(job.staging) / fs::path(job.datafile).filename()).string());
+	std::fflush(nullptr);
+	::_exit(0);
+}
+
+} // namespace
+
+bool PreprocessMaps(const std::vector<std::string> &maps, const DataFileFunction &datafile,
+                    const PreprocessFunction &preprocess, const PreprocessOptions &opt, FILE *report)
+{
+	std::fprintf(report, "map,status,time_s,output_bytes,max_rss_kb\n");
+	bool ok = true;
+	Manifest producer;
+	producer.producer = Fnv(FNV_OFFSET, reinterpret_cast<const unsigned char*>(opt.producer.data()), opt.producer.size());
+	if (opt.exeChecksum && !Checksum("/proc/self/exe", producer.exe))
+		std::fprintf(stderr, "Cannot checksum /proc/self/exe, outputs are not checked against the executable\n");
+	producer.env = EnvChecksum(opt.envPrefixes);
+	std::vector<Job> pending;
+	std::map<std::string, std::string> seen; // datafile -> map
+	for (const auto &m : maps) {
+		Job job;
+		job.mapfile = m;
+		job.datafile = datafile(m);
+		job.manifest = producer;
+		if (!Checksum(m, job.manifest.map)) {
+			std::fprintf(stderr, "Cannot read map %s\n", m.c_str());
+			Report(report, m, "failed", 0, 0, 0);
+			ok = false;
+			continue;
+		}
+		if (auto [it, inserted] = seen.emplace(job.datafile, m); !inserted) {
+			std::fprintf(stderr, "%s and %s share %s, skipping the latter\n", it->second.c_str(), m.c_str(), job.datafile.c_str());
+			Report(report, m, "failed", 0, 0, 0);
+			ok = false;
+			continue;
+		}
+		std::uint64_t bytes;
+		if (UpToDate(job.datafile, job.manifest, job.previous, bytes)) {
+			Report(report, m, "up-to-date", 0, bytes, 0);
+			continue;
+		}
+		fs::path dir = fs::path(job.datafile).parent_path();
+		job.staging = (dir / (".staging-" + fs::path(job.datafile).filename().string())).string();
+		std::error_code ec;
+		fs::remove_all(job.staging, ec);
+		fs::create_directories(job.staging, ec);
+		job.mapSize = fs::file_size(m);
+		pending.push_back(job);
+	}
+	// largest maps first so a long map does not start last and hold up the whole run
+	std::stable_sort(pending.begin(), pending.end(), [](const Job &a, const Job &b) { return a.mapSize > b.mapSize; });
+
+	unsigned jobs = std::max(opt.jobs, 1u);
+	unsigned threads = 1;
+	if (opt.multiCpu && !pending.empty()) {
+		unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+		threads = std::max(cores / std::min<unsigned>(jobs, pending.size()), 1u);
+	}
+
+	std::map<pid_t, Job> running;
+	size_t next = 0;
+	while (next < pending.size() || !running.empty()) {
+		while (running.size() < jobs && next < pending.size()) {
+			Job &job = pending[next++];
+			job.start = std::chrono::steady_clock::now();
+			pid_t pid = Launch(job, preprocess, opt, threads);
+			if (pid < 0) {
+				std::fprintf(stderr, "Cannot fork for %s\n", job.mapfile.c_str());
+				Report(report, job.mapfile, "failed", 0, 0, 0);
+				ok = false;
+				continue;
+			}
+			running.emplace(pid, job);
+		}
+		if (running.empty())
+			continue;
+		int status;
+		rusage usage;
+		pid_t pid = ::wait4(-1, &status, 0, &usage);
+		if (pid < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		auto it = running.find(pid);
+		if (it == running.end())
+			continue;
+		Job &job = it->second;
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - job.start).count();
+		std::uint64_t bytes = 0;
+		if (WIFEXITED(status) && WEXITSTATUS(status) == 0 && CommitOutputs(job, bytes)) {
+			Report(report, job.mapfile, "preprocessed", seconds, bytes, usage.ru_maxrss);
+		} else {
+			if (WIFSIGNALED(status))
+				std::fprintf(stderr, "Preprocessing %s killed by signal %d\n", job.mapfile.c_str(), WTERMSIG(status));
+			else if (WIFEXITED(status) && WEXITSTATUS(status) != 0)
+				std::fprintf(stderr, "Preprocessing %s exited with %d\n", job.mapfile.c_str(), WEXITSTATUS(status));
+			else
+				std::fprintf(stderr, "Cannot store outputs of %s\n", job.mapfile.c_str());
+			// previous outputs stay in place, the stale manifest keeps the map from being skipped
+			std::error_code ec;
+			fs::remove_all(job.staging, ec);
+			Report(report, job.mapfile, "failed", seconds, 0, usage.ru_maxrss);
+			ok = false;
+		}
+		running.erase(it);
+	}
+	return ok;
+}
+
+std::vector<std::string> ListMaps(const std::string &path)
+{
+	std::vector<std::string> maps;
+	std::error_code ec;
+	if (fs::is_directory(path, ec)) {
+		for (const auto &e : fs::directory_iterator(path, ec)) {
+			if (e.is_regular_file() && e.path().extension() == ".map")
+				maps.push_back(e.path().string());
+		}
+		std::sort(maps.begin(), maps.end());
+		return maps;
+	}
+	std::ifstream in(path);
+	std::string line;
+	while (std::getline(in, line)) {
+		line.erase(0, line.find_first_not_of(" \t"));
+		line.erase(line.find_last_not_of(" \t\r") + 1);
+		if (!line.empty() && line[0] != '#')
+			maps.push_back(line);
+	}
+	return maps;
+}
+
+bool ReadConfigFlag(const char *fname, const char *key)
+{
+	// config.json is not strict json (trailing commas), so look for "key" : true directly
+	std::ifstream in(fname);
+	std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	std::string quoted = std::string("\"") + key + "\"";
+	size_t p = text.find(quoted);
+	if (p == std::string::npos)
+		return false;
+	p = text.find_first_not_of(" \t\r\n", p + quoted.size());
+	if (p == std::string::npos || text[p] != ':')
+		return false;
+	p = text.find_first_not_of(" \t\r\n", p + 1);
+	return p != std::string::npos && text.compare(p, 4, "true") == 0;
+}
@@ -0,0 +1,73 @@
+/*
+Copyright (c) 2023 Grid-based Path Planning Competition and Contributors <https://gppc.search-conference.org/>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef GPPC_PREPROCESSDRIVER_H
+#define GPPC_PREPROCESSDRIVER_H
+
+#include <cstdio>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <functional>
+
+struct PreprocessOptions {
+	// maps preprocessed at the same time, each in its own process
+	unsigned jobs = 1;
+	// config.json multi_cpu_preprocessing, spreads the cores over the running maps as thread budget
+	bool multiCpu = false;
+	// address space limit of each map's process in bytes, 0 for none
+	std::size_t memoryCap = 0;
+	// identifies the preprocessing code, outputs of a different producer are redone
+	std::string producer;
+	// also redo outputs written by a different executable, so any rebuild reprocesses every map
+	bool exeChecksum = false;
+	// environment variables starting with these change the outputs, e.g. engine selection
+	std::vector<std::string> envPrefixes;
+};
+
+// datafile name of a map, as passed to PreprocessMap
+typedef std::function<std::string(const std::string &mapfile)> DataFileFunction;
+// load mapfile and preprocess it into datafile, runs in a forked child process
+typedef std::function<void(const std::string &mapfile, const std::string &datafile)> PreprocessFunction;
+
+/**
+ * Preprocess many maps, largest first, keeping up to opt.jobs forked child processes busy.
+ * Every child runs under the memory cap with GPPC_PREPROCESS_THREADS set to its thread budget
+ * (1 unless opt.multiCpu), and preprocesses into a staging directory next to datafile whose files are
+ * moved beside datafile once it succeeds.  Those files are the map's outputs: their checksums are
+ * recorded in datafile.manifest with checksums of the map, opt.producer, the opt.envPrefixes
+ * environment and, if opt.exeChecksum, the executable.  Maps whose manifest still matches are skipped, and only outputs listed in a map's own
+ * manifest are ever replaced.
+ * One csv row `map,status,time_s,output_bytes,max_rss_kb` is written to report per map, status is
+ * one of `preprocessed`, `up-to-date` or `failed`.
+ * @returns false if any map failed
+ */
+bool PreprocessMaps(const std::vector<std::string> &maps, const DataFileFunction &datafile,
+                    const PreprocessFunction &preprocess, const PreprocessOptions &opt, FILE *report);
+
+// the .map files of a directory, or the maps listed one per line in a file (blank and # lines skipped)
+std::vector<std::string> ListMaps(const std::string &path);
+
+// true if the boolean key is set to true in a json config such as config.json
+bool ReadConfigFlag(const char *fname, const char *key);
+
+#endif // GPPC_PREPROCESSDRIVER_H
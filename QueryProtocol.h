@@ -0,0 +1,95 @@
+/*
+Copyright (c) 2023 Grid-based Path Planning Competition and Contributors <https://gppc.search-conference.org/>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef GPPC_QUERYPROTOCOL_H
+#define GPPC_QUERYPROTOCOL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cerrno>
+#include <unistd.h>
+
+/**
+ * Binary protocol of `./run -serve`, shared with the client in client/.
+ * Fields are unpadded, in host byte order (client and server share the machine).  A connection carries any number of request/response pairs:
+ *
+ *   request:  uint32 REQUEST_MAGIC, uint32 map_size, char map[map_size], uint32 count, Query[count]
+ *   response: uint32 RESPONSE_MAGIC, uint32 status, uint32 count, count times
+ *             { uint64 time_ns, uint32 path_size, PathPoint[path_size] }
+ *
+ * `map` is the path of the .map file as it would be given to `./run -run`.  Responses list the queries
+ * in request order, `time_ns` is the server side search time of that query.  If status is not STATUS_OK
+ * count is 0.
+ */
+namespace GPPC { namespace protocol {
+
+constexpr std::uint32_t REQUEST_MAGIC = 0x31515047;  // "GPQ1"
+constexpr std::uint32_t RESPONSE_MAGIC = 0x31525047; // "GPR1"
+// a single request is rejected above this many queries
+constexpr std::uint32_t MAX_QUERIES = 1u << 20;
+constexpr std::uint32_t MAX_MAP_NAME = 4096;
+
+enum Status : std::uint32_t {
+	STATUS_OK = 0,
+	STATUS_BAD_MAP = 1,
+};
+
+struct Query {
+	std::int32_t sx, sy, gx, gy;
+};
+
+struct PathPoint {
+	std::int32_t x, y;
+};
+
+// read exactly size bytes, false on error or end of stream
+inline bool ReadAll(int fd, void *data, std::size_t size)
+{
+	char *p = static_cast<char*>(data);
+	while (size != 0) {
+		ssize_t n = ::read(fd, p, size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		p += n; size -= static_cast<std::size_t>(n);
+	}
+	return true;
+}
+
+inline bool WriteAll(int fd, const void *data, std::size_t size)
+{
+	const char *p = static_cast<const char*>(data);
+	while (size != 0) {
+		ssize_t n = ::write(fd, p, size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		p += n; size -= static_cast<std::size_t>(n);
+	}
+	return true;
+}
+
+}} // namespace GPPC::protocol
+
+#endif // GPPC_QUERYPROTOCOL_H
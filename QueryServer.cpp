@@ -0,0 +1,321 @@
+/*
+Copyright (c) 2023 Grid-based Path Planning Competition and Contributors <https://gppc.search-conference.org/>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <csignal>
+#include <cerrno>
+#include <atomic>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include "QueryServer.h"
+#include "Entry.h"
+#include "Timer.h"
+
+using namespace GPPC::protocol;
+
+namespace {
+
+bool CallGetPath(void *data, xyLoc s, xyLoc g, std::vector<xyLoc> &path) {
+	return GetPath(data, s, g, path);
+}
+
+bool CallGetPath(void *data, xyLocWide s, xyLocWide g, std::vector<xyLocWide> &path) {
+	return GetPathWide(data, s, g, path);
+}
+
+bool InMap(const ResidentMap &map, std::int32_t x, std::int32_t y) {
+	return x >= 0 && y >= 0 && x < map.width && y < map.height;
+}
+
+template <typename Loc>
+void Solve(void *data, const ResidentMap &map, const Query &q, std::vector<Loc> &path,
+           std::uint64_t &time_ns, std::vector<PathPoint> &out)
+{
+	path.clear();
+	out.clear();
+	time_ns = 0;
+	// engines assume the query lies on the map, an off-map query has no path
+	if (!InMap(map, q.sx, q.sy) || !InMap(map, q.gx, q.gy))
+		return;
+	Loc s, g;
+	s.x = q.sx; s.y = q.sy;
+	g.x = q.gx; g.y = q.gy;
+	Timer t;
+	t.StartTimer();
+	while (!CallGetPath(data, s, g, path)) { }
+	time_ns = static_cast<std::uint64_t>(t.EndTimer().count());
+	out.reserve(path.size());
+	for (const auto &p : path)
+		out.push_back(PathPoint{p.x, p.y});
+}
+
+void *Acquire(ResidentMap &map) {
+	std::lock_guard<std::mutex> l(map.lock);
+	if (map.idle.empty()) {
+		// creation stays under the lock, PrepareForSearch may write files next to datafile
+		return PrepareForSearch(map.bits, map.width, map.height, map.datafile);
+	}
+	void *data = map.idle.back();
+	map.idle.pop_back();
+	return data;
+}
+
+void Release(ResidentMap &map, void *data) {
+	std::lock_guard<std::mutex> l(map.lock);
+	map.idle.push_back(data);
+}
+
+template <typename T>
+void Append(std::vector<char> &buf, const T &v) {
+	const char *p = reinterpret_cast<const char*>(&v);
+	buf.insert(buf.end(), p, p + sizeof(T));
+}
+
+} // namespace
+
+QueryServer::QueryServer(KeyFunction key, LoadFunction load, unsigned threads)
+	:key(std::move(key)), load(std::move(load)), stopping(false)
+{
+	for (unsigned i = 0; i < std::max(threads, 1u); i++)
+		workers.emplace_back(&QueryServer::WorkerLoop, this);
+}
+
+QueryServer::~QueryServer()
+{
+	{
+		std::lock_guard<std::mutex> l(tasksLock);
+		stopping = true;
+	}
+	tasksReady.notify_all();
+	for (auto &w : workers)
+		w.join();
+}
+
+std::shared_ptr<ResidentMap> QueryServer::GetMap(const std::string &mapfile)
+{
+	std::string k = key(mapfile);
+	std::shared_ptr<ResidentMap> map;
+	bool loader = false;
+	{
+		// only the placeholder is inserted under the global lock, loading a large map must not stall
+		// requests for maps already resident
+		std::lock_guard<std::mutex> l(mapsLock);
+		std::shared_ptr<ResidentMap> &entry = maps[k];
+		if (entry == nullptr) {
+			entry = std::make_shared<ResidentMap>();
+			loader = true;
+		}
+		map = entry;
+	}
+	if (!loader) {
+		std::unique_lock<std::mutex> l(map->lock);
+		map->ready.wait(l, [&] { return map->state != ResidentMap::State::Loading; });
+		return map->state == ResidentMap::State::Ready ? map : nullptr;
+	}
+
+	bool ok = load(mapfile, *map);
+	// prepare one instance up front so the first batch does not pay for it
+	void *data = ok ? PrepareForSearch(map->bits, map->width, map->height, map->datafile) : nullptr;
+	if (!ok) {
+		std::fprintf(stderr, "Cannot load map %s\n", mapfile.c_str());
+		// forget the failure so a later request can retry, waiters keep their reference
+		std::lock_guard<std::mutex> l(mapsLock);
+		maps.erase(k);
+	}
+	{
+		std::lock_guard<std::mutex> l(map->lock);
+		map->state = ok ? ResidentMap::State::Ready : ResidentMap::State::Failed;
+		if (ok)
+			map->idle.push_back(data);
+	}
+	map->ready.notify_all();
+	return ok ? map : nullptr;
+}
+
+void QueryServer::Submit(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> l(tasksLock);
+		tasks.push_back(std::move(task));
+	}
+	tasksReady.notify_one();
+}
+
+void QueryServer::WorkerLoop()
+{
+	while (true) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> l(tasksLock);
+			tasksReady.wait(l, [this] { return stopping || !tasks.empty(); });
+			if (tasks.empty())
+				return;
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+		task();
+	}
+}
+
+void QueryServer::RunBatch(ResidentMap &map, const std::vector<Query> &queries, std::vector<Answer> &answers)
+{
+	answers.resize(queries.size());
+	if (queries.empty())
+		return;
+	// one task per worker pulling queries off a shared counter, so each task checks out a single
+	// engine instance and long queries do not hold up a fixed slice of the batch
+	std::atomic<size_t> next(0);
+	size_t running = std::min(workers.size(), queries.size());
+	std::mutex doneLock;
+	std::condition_variable done;
+	bool wide = map.width > INT16_MAX || map.height > INT16_MAX;
+	for (size_t t = 0, te = running; t < te; t++) {
+		Submit([&] {
+			void *data = Acquire(map);
+			std::vector<xyLoc> path;
+			std::vector<xyLocWide> pathWide;
+			for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < queries.size(); ) {
+				if (wide)
+					Solve(data, map, queries[i], pathWide, answers[i].time_ns, answers[i].path);
+				else
+					Solve(data, map, queries[i], path, answers[i].time_ns, answers[i].path);
+			}
+			Release(map, data);
+			std::lock_guard<std::mutex> l(doneLock);
+			if (--running == 0)
+				done.notify_one();
+		});
+	}
+	std::unique_lock<std::mutex> l(doneLock);
+	done.wait(l, [&] { return running == 0; });
+}
+
+void QueryServer::ServeStream(int in, int out)
+{
+	std::string mapfile;
+	std::vector<Query> queries;
+	std::vector<Answer> answers;
+	std::vector<char> buf;
+	while (true) {
+		std::uint32_t head[2];
+		if (!ReadAll(in, head, sizeof(head)))
+			return;
+		if (head[0] != REQUEST_MAGIC || head[1] > MAX_MAP_NAME) {
+			std::fprintf(stderr, "Malformed request, closing connection\n");
+			return;
+		}
+		mapfile.resize(head[1]);
+		std::uint32_t count;
+		if (!ReadAll(in, &mapfile[0], mapfile.size()) || !ReadAll(in, &count, sizeof(count)))
+			return;
+		if (count > MAX_QUERIES) {
+			std::fprintf(stderr, "Request of %u queries exceeds %u, closing connection\n", count, MAX_QUERIES);
+			return;
+		}
+		queries.resize(count);
+		if (!ReadAll(in, queries.data(), queries.size() * sizeof(Query)))
+			return;
+
+		std::shared_ptr<ResidentMap> map = GetMap(mapfile);
+		buf.clear();
+		Append(buf, RESPONSE_MAGIC);
+		if (map == nullptr) {
+			Append(buf, static_cast<std::uint32_t>(STATUS_BAD_MAP));
+			Append(buf, std::uint32_t{0});
+		} else {
+			RunBatch(*map, queries, answers);
+			Append(buf, static_cast<std::uint32_t>(STATUS_OK));
+			Append(buf, count);
+			for (size_t i = 0; i < count; i++) {
+				Append(buf, answers[i].time_ns);
+				Append(buf, static_cast<std::uint32_t>(answers[i].path.size()));
+				const char *p = reinterpret_cast<const char*>(answers[i].path.data());
+				buf.insert(buf.end(), p, p + answers[i].path.size() * sizeof(PathPoint));
+			}
+		}
+		if (!WriteAll(out, buf.data(), buf.size()))
+			return;
+	}
+}
+
+bool QueryServer::ServeSocket(const std::string &path)
+{
+	sockaddr_un addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr.sun_path)) {
+		std::fprintf(stderr, "Socket path %s is too long\n", path.c_str());
+		return false;
+	}
+	std::memcpy(addr.sun_path, path.c_str(), path.size());
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return false;
+	// a socket left behind by a previous server would make bind fail, anything else at path, including the
+	// socket of a server still listening on it, is not ours to remove
+	struct stat st;
+	if (::lstat(path.c_str(), &st) == 0) {
+		if (!S_ISSOCK(st.st_mode)) {
+			std::fprintf(stderr, "%s exists and is not a socket, refusing to serve on it\n", path.c_str());
+			::close(fd);
+			return false;
+		}
+		int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		int err = probe < 0 ? errno
+		        : ::connect(probe, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 ? 0 : errno;
+		if (probe >= 0)
+			::close(probe);
+		if (err != ECONNREFUSED) {
+			if (err == 0)
+				std::fprintf(stderr, "A server is already listening on %s, refusing to serve on it\n", path.c_str());
+			else
+				std::fprintf(stderr, "Cannot probe socket %s: %s\n", path.c_str(), std::strerror(err));
+			::close(fd);
+			return false;
+		}
+		::unlink(path.c_str());
+	}
+	if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+		std::fprintf(stderr, "Cannot listen on %s\n", path.c_str());
+		::close(fd);
+		return false;
+	}
+	// a client hanging up mid-response must not kill the server
+	std::signal(SIGPIPE, SIG_IGN);
+	while (true) {
+		int conn = ::accept(fd, nullptr, nullptr);
+		if (conn < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			::close(fd);
+			return false;
+		}
+		std::thread([this, conn] {
+			ServeStream(conn, conn);
+			::close(conn);
+		}).detach();
+	}
+}
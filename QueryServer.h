@@ -0,0 +1,106 @@
+/*
+Copyright (c) 2023 Grid-based Path Planning Competition and Contributors <https://gppc.search-conference.org/>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef GPPC_QUERYSERVER_H
+#define GPPC_QUERYSERVER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <thread>
+#include "QueryProtocol.h"
+
+/**
+ * A map kept resident by the server.
+ * Engine instances returned by `PrepareForSearch` are not shared between threads, each worker checks
+ * one out for the duration of its share of a batch, so at most one instance per worker is ever created.
+ * The map is loaded by the first request naming it, later requests wait on `ready` until it is.
+ */
+struct ResidentMap {
+	enum class State { Loading, Ready, Failed };
+
+	std::vector<bool> bits;
+	int width = 0;
+	int height = 0;
+	std::string datafile;
+
+	std::mutex lock;
+	std::condition_variable ready;
+	State state = State::Loading;
+	std::vector<void*> idle;
+};
+
+/**
+ * Persistent query server behind `./run -serve`.
+ * Requests (see QueryProtocol.h) name a map and carry a batch of queries, the queries of a batch are
+ * spread over a fixed pool of worker threads and answered in request order.  Maps are loaded and
+ * prepared on first use, or up front through `Preload`, and stay resident for the lifetime of the server.
+ */
+class QueryServer {
+public:
+	// resident map key of a .map path, maps with equal keys share search structures
+	typedef std::function<std::string(const std::string &mapfile)> KeyFunction;
+	// fill bits, width, height and datafile of map, false if the map cannot be read
+	typedef std::function<bool(const std::string &mapfile, ResidentMap &map)> LoadFunction;
+
+	QueryServer(KeyFunction key, LoadFunction load, unsigned threads);
+	~QueryServer();
+	QueryServer(const QueryServer&) = delete;
+	QueryServer& operator=(const QueryServer&) = delete;
+
+	bool Preload(const std::string &mapfile) { return GetMap(mapfile) != nullptr; }
+	// answer requests read from in on out until in is closed or a malformed request is read
+	void ServeStream(int in, int out);
+	// serve every connection to a Unix domain socket at path, only returns if the socket cannot be set up
+	bool ServeSocket(const std::string &path);
+
+private:
+	struct Answer {
+		std::uint64_t time_ns;
+		std::vector<GPPC::protocol::PathPoint> path;
+	};
+
+	// nullptr if the map cannot be loaded, only blocks requests for the same map while it is loading
+	std::shared_ptr<ResidentMap> GetMap(const std::string &mapfile);
+	void RunBatch(ResidentMap &map, const std::vector<GPPC::protocol::Query> &queries, std::vector<Answer> &answers);
+	void Submit(std::function<void()> task);
+	void WorkerLoop();
+
+	KeyFunction key;
+	LoadFunction load;
+
+	std::mutex mapsLock;
+	std::map<std::string, std::shared_ptr<ResidentMap>> maps;
+
+	std::mutex tasksLock;
+	std::condition_variable tasksReady;
+	std::deque<std::function<void()>> tasks;
+	bool stopping;
+	std::vector<std::thread> workers;
+};
+
+#endif // GPPC_QUERYSERVER_H
@@ -0,0 +1,242 @@
+/*
+Copyright (c) 2023 Grid-based Path Planning Competition and Contributors <https://gppc.search-conference.org/>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include "ResultWriter.h"
+
+OutputStream::OutputStream(FILE *f, bool async)
+	:file(f), async(async), closed(false), ring(async ? RING_SIZE : 1), head(0), tail(0), done(false)
+{
+	for (auto &c : ring) {
+		c.data.resize(CHUNK_SIZE);
+		c.size = 0;
+	}
+	pos = ring[0].data.data();
+	end = pos + CHUNK_SIZE;
+	if (async)
+		writer = std::thread(&OutputStream::WriterLoop, this);
+}
+
+OutputStream::~OutputStream()
+{
+	Close();
+}
+
+void OutputStream::Close()
+{
+	if (closed)
+		return;
+	Flush();
+	if (async) {
+		done.store(true, std::memory_order_release);
+		writer.join();
+	}
+	closed = true;
+}
+
+void OutputStream::Write(const void *data, size_t size)
+{
+	const char *p = static_cast<const char*>(data);
+	while (size != 0) {
+		Reserve(1);
+		size_t n = std::min(size, static_cast<size_t>(end - pos));
+		std::memcpy(pos, p, n);
+		pos += n; p += n; size -= n;
+	}
+}
+
+void OutputStream::Put(long long v)
+{
+	Reserve(24);
+	pos = std::to_chars(pos, end, v).ptr;
+}
+
+void OutputStream::PutFixed(double v, int precision)
+{
+	// largest double in fixed notation has 309 integer digits
+	Reserve(320 + precision);
+	pos = std::to_chars(pos, end, v, std::chars_format::fixed, precision).ptr;
+}
+
+void OutputStream::NextChunk()
+{
+	size_t h = head.load(std::memory_order_relaxed);
+	Chunk &c = ring[h % ring.size()];
+	c.size = static_cast<size_t>(pos - c.data.data());
+	if (!async) {
+		if (file != nullptr && c.size != 0)
+			std::fwrite(c.data.data(), 1, c.size, file);
+	} else {
+		head.store(++h, std::memory_order_release);
+		// ring full, wait for the writer to free a chunk
+		while (h - tail.load(std::memory_order_acquire) >= ring.size())
+			std::this_thread::yield();
+	}
+	pos = ring[h % ring.size()].data.data();
+	end = pos + CHUNK_SIZE;
+}
+
+void OutputStream::Flush()
+{
+	NextChunk();
+	if (async) {
+		while (tail.load(std::memory_order_acquire) != head.load(std::memory_order_relaxed))
+			std::this_thread::yield();
+	}
+	if (file != nullptr)
+		std::fflush(file);
+}
+
+void OutputStream::WriterLoop()
+{
+	while (true) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t != head.load(std::memory_order_acquire)) {
+			const Chunk &c = ring[t % ring.size()];
+			if (file != nullptr)
+				std::fwrite(c.data.data(), 1, c.size, file);
+			tail.store(t + 1, std::memory_order_release);
+		} else if (done.load(std::memory_order_acquire)) {
+			return;
+		} else {
+			// idle, stay off the cpu of the timed loop
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	}
+}
+
+void WriteCsvRow(OutputStream &out, const std::string &map, const std::string &scen, const ResultRecord &r)
+{
+	out.Put(map); out.Put(',');
+	out.Put(scen); out.Put(',');
+	out.Put(static_cast<long long>(r.experiment_id)); out.Put(',');
+	out.Put(static_cast<long long>(r.path_size)); out.Put(',');
+	out.PutFixed(r.path_length, 9); out.Put(',');
+	out.PutFixed(r.ref_length, 9); out.Put(',');
+	out.Put(static_cast<long long>(r.time_cost)); out.Put(',');
+	out.Put(static_cast<long long>(r.first_steps_cost)); out.Put(',');
+	out.Put(static_cast<long long>(r.max_step_time)); out.Put(',');
+	out.Put(static_cast<long long>(r.expansions)); out.Put(',');
+	out.PutFixed(r.suboptimality, 9); out.Put('\n');
+}
+
+double Suboptimality(double path_length, double ref_length)
+{
+	return ref_length > 0 ? path_length / ref_length : 1.0;
+}
+
+namespace {
+
+struct ResultRecordV1 {
+	std::int64_t experiment_id;
+	std::int64_t path_size;
+	double path_length;
+	double ref_length;
+	std::int64_t time_cost;
+	std::int64_t first_steps_cost;
+	std::int64_t max_step_time;
+};
+
+void WriteString(OutputStream &out, const std::string &s)
+{
+	std::uint32_t len = static_cast<std::uint32_t>(s.size());
+	out.Write(&len, sizeof(len));
+	out.Write(s.data(), s.size());
+}
+
+bool ReadString(FILE *f, std::string &s)
+{
+	std::uint32_t len;
+	if (std::fread(&len, sizeof(len), 1, f) != 1)
+		return false;
+	s.resize(len);
+	return len == 0 || std::fread(&s[0], 1, len, f) == len;
+}
+
+} // namespace
+
+ResultWriter::ResultWriter(const std::string &fname, const std::string &map, const std::string &scen, bool binary, bool async)
+	:file(std::fopen(fname.c_str(), binary ? "wb" : "w")), binary(binary), map(map), scen(scen), out(file, async)
+{
+	if (binary) {
+		out.Write(MAGIC, sizeof(MAGIC));
+		WriteString(out, map);
+		WriteString(out, scen);
+	} else {
+		out.Put(CsvHeader()); out.Put('\n');
+	}
+}
+
+ResultWriter::~ResultWriter()
+{
+	out.Close();
+	if (file != nullptr)
+		std::fclose(file);
+}
+
+void ResultWriter::Add(const ResultRecord &r)
+{
+	if (binary)
+		out.Write(&r, sizeof(r));
+	else
+		WriteCsvRow(out, map, scen, r);
+}
+
+bool ConvertResultToCsv(const char *bin, const char *csv)
+{
+	FILE *in = std::fopen(bin, "rb");
+	if (in == nullptr)
+		return false;
+	char magic[sizeof(ResultWriter::MAGIC)];
+	std::string map, scen;
+	if (std::fread(magic, sizeof(magic), 1, in) != 1
+	    || (std::memcmp(magic, ResultWriter::MAGIC, sizeof(magic)) != 0 && std::memcmp(magic, ResultWriter::MAGIC_V1, sizeof(magic)) != 0)
+	    || !ReadString(in, map) || !ReadString(in, scen)) {
+		std::fclose(in);
+		return false;
+	}
+	FILE *f = std::fopen(csv, "w");
+	if (f == nullptr) {
+		std::fclose(in);
+		return false;
+	}
+	{
+		OutputStream out(f, false);
+		out.Put(ResultWriter::CsvHeader()); out.Put('\n');
+		ResultRecord r;
+		if (std::memcmp(magic, ResultWriter::MAGIC_V1, sizeof(magic)) == 0) {
+			ResultRecordV1 v1;
+			while (std::fread(&v1, sizeof(v1), 1, in) == 1) {
+				r = ResultRecord{v1.experiment_id, v1.path_size, v1.path_length, v1.ref_length, v1.time_cost,
+				                 v1.first_steps_cost, v1.max_step_time, -1, Suboptimality(v1.path_length, v1.ref_length)};
+				WriteCsvRow(out, map, scen, r);
+			}
+		} else {
+			while (std::fread(&r, sizeof(r), 1, in) == 1)
+				WriteCsvRow(out, map, scen, r);
+		}
+	}
+	std::fclose(in);
+	return std::fclose(f) == 0;
+}
@@ -0,0 +1,125 @@
+/*
+Copyright (c) 2023 Grid-based Path Planning Competition and Contributors <https://gppc.search-conference.org/>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef GPPC_RESULTWRITER_H
+#define GPPC_RESULTWRITER_H
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <atomic>
+#include <thread>
+
+/**
+ * Buffered output to a FILE.
+ * Text is formatted with std::to_chars into fixed size chunks.  Full chunks are written by the
+ * calling thread or, in async mode, handed to a background writer thread through a lock-free
+ * single-producer single-consumer ring so the caller never blocks on the file.
+ */
+class OutputStream {
+public:
+	static constexpr size_t CHUNK_SIZE = 1 << 16;
+	static constexpr size_t RING_SIZE = 64;
+
+	OutputStream(FILE *f, bool async);
+	~OutputStream();
+	OutputStream(const OutputStream&) = delete;
+	OutputStream& operator=(const OutputStream&) = delete;
+
+	void Write(const void *data, size_t size);
+	void Put(char c) { Reserve(1); *pos++ = c; }
+	void Put(std::string_view s) { Write(s.data(), s.size()); }
+	void Put(long long v);
+	void PutFixed(double v, int precision);
+	// write out everything buffered so far, waits for the writer thread in async mode
+	void Flush();
+	// flush and stop the writer thread, the FILE is left open for the caller to close
+	void Close();
+
+private:
+	struct Chunk {
+		std::vector<char> data;
+		size_t size;
+	};
+	void Reserve(size_t n) { if (static_cast<size_t>(end - pos) < n) NextChunk(); }
+	void NextChunk();
+	void WriterLoop();
+
+	FILE *file;
+	bool async;
+	bool closed;
+	std::vector<Chunk> ring;
+	// chunks [tail, head) are full and owned by the writer thread, ring[head] is being filled
+	std::atomic<size_t> head;
+	std::atomic<size_t> tail;
+	std::atomic<bool> done;
+	char *pos;
+	char *end;
+	std::thread writer;
+};
+
+/**
+ * One result.csv row.
+ */
+struct ResultRecord {
+	std::int64_t experiment_id;
+	std::int64_t path_size;
+	double path_length;
+	double ref_length;
+	std::int64_t time_cost;
+	std::int64_t first_steps_cost;
+	std::int64_t max_step_time;
+	std::int64_t expansions; // -1 if the search does not count them
+	double suboptimality;    // path_length / ref_length, 1 for zero length queries
+};
+
+/**
+ * Writes the per-query results either as result.csv or, in binary mode, as a header with the map and
+ * scenario names followed by raw ResultRecord's that `ConvertResultToCsv` turns back into csv.
+ */
+class ResultWriter {
+public:
+	static constexpr char MAGIC[8] = {'G','P','P','C','R','E','S','2'};
+	// version 1 files, records without expansions and suboptimality, can still be converted
+	static constexpr char MAGIC_V1[8] = {'G','P','P','C','R','E','S','1'};
+	static const char *CsvHeader() { return "map,scen,experiment_id,path_size,path_length,ref_length,time_cost,20steps_cost,max_step_time,expansions,suboptimality"; }
+
+	ResultWriter(const std::string &fname, const std::string &map, const std::string &scen, bool binary, bool async);
+	~ResultWriter();
+	void Add(const ResultRecord &r);
+
+private:
+	FILE *file;
+	bool binary;
+	std::string map;
+	std::string scen;
+	OutputStream out;
+};
+
+double Suboptimality(double path_length, double ref_length);
+void WriteCsvRow(OutputStream &out, const std::string &map, const std::string &scen, const ResultRecord &r);
+// returns false if bin is not a binary result file or csv cannot be written
+bool ConvertResultToCsv(const char *bin, const char *csv);
+
+#endif // GPPC_RESULTWRITER_H
@@ -21,6 +21,7 @@ SOFTWARE.
 */
 
 #include <fstream>
+#include <iomanip>
 using std::ifstream;
 using std::ofstream;
 
@@ -78,7 +79,8 @@ void ScenarioLoader::Save(const char *fname)
 	
 	float ver = 1.0;
 	ofile<<"version "<<ver<<std::endl;
-	
+	// distances with 5 decimals as in the published scenario files, the default 6 significant digits lose precision
+	ofile<<std::fixed<<std::setprecision(5);
 	
 	for (unsigned int x = 0; x < experiments.size(); x++)
 	{
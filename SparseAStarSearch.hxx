@@ -0,0 +1,146 @@
+#ifndef OPT_GPPC_SPARSE_ASTAR_SEARCH_HXX
+#define OPT_GPPC_SPARSE_ASTAR_SEARCH_HXX
+
+#include "BaselineSearch.hxx"
+#include <unordered_map>
+#include <cstdlib>
+
+namespace baseline
+{
+
+using std::uint64_t;
+
+/**
+ * A* over a map that is too large for per-cell Node arrays.
+ * Search state lives in a hash table keyed by 64-bit cell id, so memory is bounded by the number of
+ * generated nodes rather than the map size and coordinates are full 32-bit.
+ * The table and open list are allocated from a QueryArena rewound for every query.
+ * Map is any type with `width`, `height` and `bool get(int x, int y)`, e.g. TiledMapStore.
+ */
+template <typename Map>
+struct SparseAStarSearch
+{
+	static constexpr uint64_t NO_PRED = std::numeric_limits<uint64_t>::max();
+
+	explicit SparseAStarSearch(const Map& l_map) : map(&l_map)
+	{ }
+
+	// nodes expanded by the last search
+	uint64_t get_expansions() const noexcept { return expansions; }
+
+	// bool search found a path, the path from s to g is written to out, out is empty otherwise
+	template <typename Loc>
+	bool search(Point s, Point g, std::vector<Loc>& out)
+	{
+		out.clear();
+		expansions = 0;
+		if (!map->get(s.first, s.second) || !map->get(g.first, g.second))
+			return false;
+		if (s == g) {
+			// zero path case
+			out.resize(2);
+			to_loc(out[0], s); to_loc(out[1], s);
+			return true;
+		}
+		states.reset(); open.reset();
+		arena.reset();
+		states.emplace(arena.resource());
+		open.emplace(std::greater<OpenNode>(), std::pmr::vector<OpenNode>(arena.resource()));
+		uint64_t sid = pack(s), gid = pack(g);
+		states->emplace(sid, State{0, NO_PRED, false});
+		open->push(OpenNode{h(s, g), 0, sid});
+		while (!open->empty()) {
+			OpenNode n = open->top(); open->pop();
+			State& S = states->find(n.id)->second;
+			if (S.closed || n.g != S.g)
+				continue; // stale
+			S.closed = true;
+			expansions++;
+			if (n.id == gid) {
+				// every edge costs at least COST_0, write the pred chain backwards from that bound
+				size_t bound = n.g / COST_0 + 1, front = bound;
+				out.resize(bound);
+				for (uint64_t id = gid; id != NO_PRED; id = states->find(id)->second.pred)
+					to_loc(out[--front], unpack(id));
+				out.erase(out.begin(), out.begin() + front);
+				return true;
+			}
+			expand(n, g);
+		}
+		return false;
+	}
+
+private:
+	struct State
+	{
+		uint64_t g;
+		uint64_t pred;
+		bool closed;
+	};
+	struct OpenNode
+	{
+		uint64_t f;
+		uint64_t g;
+		uint64_t id;
+		bool operator>(const OpenNode& o) const noexcept
+		{
+			// tie-break towards deeper nodes
+			return f != o.f ? f > o.f : g < o.g;
+		}
+	};
+
+	uint64_t pack(Point p) const noexcept
+	{
+		return static_cast<uint64_t>(static_cast<uint32_t>(p.second)) << 32 | static_cast<uint32_t>(p.first);
+	}
+	static Point unpack(uint64_t id) noexcept
+	{
+		return Point(static_cast<int>(id & 0xffff'ffff), static_cast<int>(id >> 32));
+	}
+	static uint64_t h(Point a, Point b) noexcept
+	{
+		uint64_t dx = static_cast<uint64_t>(std::abs(a.first - b.first));
+		uint64_t dy = static_cast<uint64_t>(std::abs(a.second - b.second));
+		return dx < dy ? dx * COST_1 + (dy - dx) * COST_0 : dy * COST_1 + (dx - dy) * COST_0;
+	}
+	void expand(const OpenNode& n, Point g)
+	{
+		Point p = unpack(n.id);
+		uint32_t mask = 0;
+		for (int i = 0, dy = -1; dy < 2; dy++)
+		for (int dx = -1; dx < 2; dx++) {
+			mask |= static_cast<uint32_t>(map->get(p.first + dx, p.second + dy)) << i++;
+		}
+		mask = ~mask; // 1 = non-trav, 0 = trav
+		auto try_push = [this,&n,p,g](int dx, int dy, uint64_t cost) {
+			Point q(p.first + dx, p.second + dy);
+			uint64_t id = pack(q);
+			uint64_t gq = n.g + cost;
+			auto [it, inserted] = states->try_emplace(id, State{gq, n.id, false});
+			if (!inserted) {
+				if (gq >= it->second.g)
+					return;
+				it->second = State{gq, n.id, false};
+			}
+			open->push(OpenNode{gq + h(q, g), gq, id});
+		};
+		if ( (mask & static_cast<uint32_t>(Compass::N)) == 0 ) try_push(0, -1, COST_0);
+		if ( (mask & static_cast<uint32_t>(Compass::E)) == 0 ) try_push(1, 0, COST_0);
+		if ( (mask & static_cast<uint32_t>(Compass::S)) == 0 ) try_push(0, 1, COST_0);
+		if ( (mask & static_cast<uint32_t>(Compass::W)) == 0 ) try_push(-1, 0, COST_0);
+		if ( (mask & static_cast<uint32_t>(Compass::NE)) == 0 ) try_push(1, -1, COST_1);
+		if ( (mask & static_cast<uint32_t>(Compass::NW)) == 0 ) try_push(-1, -1, COST_1);
+		if ( (mask & static_cast<uint32_t>(Compass::SE)) == 0 ) try_push(1, 1, COST_1);
+		if ( (mask & static_cast<uint32_t>(Compass::SW)) == 0 ) try_push(-1, 1, COST_1);
+	}
+
+	const Map* map;
+	uint64_t expansions = 0;
+	QueryArena arena;
+	std::optional<std::pmr::unordered_map<uint64_t, State>> states;
+	std::optional<std::priority_queue<OpenNode, std::pmr::vector<OpenNode>, std::greater<OpenNode>>> open;
+};
+
+} // namespace baseline
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef OPT_GPPC_TILED_MAP_STORE_HXX
+#define OPT_GPPC_TILED_MAP_STORE_HXX
+
+#include <vector>
+#include <string>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace baseline
+{
+
+using std::uint32_t;
+using std::size_t;
+
+/**
+ * Out-of-core obstacle bitmap of 64x64 bit tiles after a header holding the map size and checksum.
+ * The file is memory-mapped read-only so tiles are paged in on demand, `release` drops them again.
+ */
+class TiledMapStore
+{
+public:
+	static constexpr uint32_t TILE_BITS = 6;
+	static constexpr uint32_t TILE = 1u << TILE_BITS;
+	static constexpr uint32_t MASK = TILE - 1;
+	static constexpr size_t TILE_BYTES = TILE * sizeof(std::uint64_t);
+	static constexpr size_t HEADER_BYTES = 4096;
+	static constexpr char MAGIC[8] = {'G','P','P','C','T','I','L','E'};
+	static constexpr uint32_t VERSION = 2;
+
+	TiledMapStore() = default;
+	TiledMapStore(const TiledMapStore&) = delete;
+	TiledMapStore& operator=(const TiledMapStore&) = delete;
+	~TiledMapStore() { close(); }
+
+	// FNV-1a over the bitmap packed into 64-bit words
+	static std::uint64_t checksum(const std::vector<bool>& bits)
+	{
+		std::uint64_t sum = 0xcbf29ce484222325ull, word = 0;
+		for (size_t i = 0; i < bits.size(); ++i) {
+			word |= static_cast<std::uint64_t>(bits[i]) << (i & 63);
+			if ((i & 63) == 63 || i + 1 == bits.size()) {
+				sum = (sum ^ word) * 0x100000001b3ull;
+				word = 0;
+			}
+		}
+		return sum;
+	}
+
+	/**
+	 * Write bits (row-major, as given to PreprocessMap) to fname in tiled format.
+	 * Tiles are produced one band of 64 rows at a time.
+	 * @returns false if the file could not be written
+	 */
+	static bool write(const std::string& fname, const std::vector<bool>& bits, int width, int height)
+	{
+		FILE* f = std::fopen(fname.c_str(), "wb");
+		if (f == nullptr)
+			return false;
+		std::array<char, HEADER_BYTES> header{};
+		std::memcpy(header.data(), MAGIC, sizeof(MAGIC));
+		const std::uint32_t meta[4] = {VERSION, static_cast<std::uint32_t>(width), static_cast<std::uint32_t>(height), TILE_BITS};
+		std::memcpy(header.data() + sizeof(MAGIC), meta, sizeof(meta));
+		const std::uint64_t sum = checksum(bits);
+		std::memcpy(header.data() + sizeof(MAGIC) + sizeof(meta), &sum, sizeof(sum));
+		bool ok = std::fwrite(header.data(), 1, header.size(), f) == header.size();
+		size_t tiles_x = (static_cast<size_t>(width) + MASK) >> TILE_BITS;
+		std::vector<std::uint64_t> band(tiles_x * TILE);
+		for (size_t ty = 0; ok && ty << TILE_BITS < static_cast<size_t>(height); ++ty) {
+			std::fill(band.begin(), band.end(), 0);
+			for (size_t r = 0; r < TILE; ++r) {
+				size_t y = (ty << TILE_BITS) + r;
+				if (y >= static_cast<size_t>(height))
+					break;
+				for (size_t x = 0; x < static_cast<size_t>(width); ++x) {
+					if (bits[y * width + x])
+						band[(x >> TILE_BITS) * TILE + r] |= std::uint64_t{1} << (x & MASK);
+				}
+			}
+			ok = std::fwrite(band.data(), sizeof(std::uint64_t), band.size(), f) == band.size();
+		}
+		return std::fclose(f) == 0 && ok;
+	}
+
+	/**
+	 * Map fname written by `write`.
+	 * @returns false if the file is missing or not a valid tile store
+	 */
+	bool open(const std::string& fname)
+	{
+		close();
+		int fd = ::open(fname.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat st;
+		if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < HEADER_BYTES) {
+			::close(fd);
+			return false;
+		}
+		void* addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (addr == MAP_FAILED)
+			return false;
+		base = static_cast<const char*>(addr);
+		bytes = static_cast<size_t>(st.st_size);
+		std::uint32_t meta[4];
+		std::memcpy(meta, base + sizeof(MAGIC), sizeof(meta));
+		width = meta[1];
+		height = meta[2];
+		std::memcpy(&map_checksum, base + sizeof(MAGIC) + sizeof(meta), sizeof(map_checksum));
+		tiles_x = (width + MASK) >> TILE_BITS;
+		size_t tiles_y = (static_cast<size_t>(height) + MASK) >> TILE_BITS;
+		if (std::memcmp(base, MAGIC, sizeof(MAGIC)) != 0 || meta[0] != VERSION || meta[3] != TILE_BITS
+		    || bytes < HEADER_BYTES + tiles_x * tiles_y * TILE_BYTES) {
+			close();
+			return false;
+		}
+		tiles = reinterpret_cast<const std::uint64_t*>(base + HEADER_BYTES);
+		// search touches tiles along the frontier, read-ahead would only waste resident memory
+		::madvise(const_cast<char*>(base), bytes, MADV_RANDOM);
+		return true;
+	}
+	void close() noexcept
+	{
+		if (base != nullptr)
+			::munmap(const_cast<char*>(base), bytes);
+		base = nullptr;
+		tiles = nullptr;
+		bytes = 0;
+		width = height = 0;
+		map_checksum = 0;
+	}
+	// drop resident tiles, they are paged back in from the file when next accessed
+	void release() noexcept
+	{
+		if (base != nullptr)
+			::madvise(const_cast<char*>(base), bytes, MADV_DONTNEED);
+	}
+
+	bool is_open() const noexcept { return base != nullptr; }
+	bool get(int x, int y) const noexcept
+	{
+		if (static_cast<std::uint32_t>(x) >= width || static_cast<std::uint32_t>(y) >= height)
+			return false;
+		size_t tile = (static_cast<size_t>(y) >> TILE_BITS) * tiles_x + (static_cast<size_t>(x) >> TILE_BITS);
+		return (tiles[tile * TILE + (y & MASK)] >> (x & MASK)) & 1;
+	}
+
+	std::uint32_t width = 0;
+	std::uint32_t height = 0;
+	// checksum of the bitmap the store was written from
+	std::uint64_t map_checksum = 0;
+
+private:
+	const char* base = nullptr;
+	const std::uint64_t* tiles = nullptr;
+	size_t bytes = 0;
+	size_t tiles_x = 0;
+};
+
+} // namespace baseline
+
+#endif
@@ -22,20 +22,91 @@ SOFTWARE.
 
 #include "Timer.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#include <cpuid.h>
+#include <cstdio>
+#include <cstdlib>
+#define GPPC_HAS_TSC
+#endif
+
+#ifdef GPPC_HAS_TSC
+namespace {
+// lfence keeps earlier instructions from being reordered past the read
+inline std::uint64_t ReadTscBegin()
+{
+	_mm_lfence();
+	std::uint64_t t = __rdtsc();
+	_mm_lfence();
+	return t;
+}
+// rdtscp waits for earlier instructions to retire, lfence keeps later ones after it
+inline std::uint64_t ReadTscEnd()
+{
+	unsigned int aux;
+	std::uint64_t t = __rdtscp(&aux);
+	_mm_lfence();
+	return t;
+}
+// CPUID.80000007H:EDX[8], the TSC ticks at a constant rate across P-, C- and T-states
+bool TscInvariant()
+{
+	unsigned int eax, ebx, ecx, edx;
+	return __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) && (edx & (1u << 8)) != 0;
+}
+}
+#endif
+
+double Timer::TscPeriod()
+{
+#ifdef GPPC_HAS_TSC
+	static const double period = [] {
+		// without an invariant TSC ticks do not map to a fixed time, refuse rather than report wrong times
+		if (!TscInvariant()) {
+			std::fprintf(stderr, "GPPC_TSC_TIMER: CPU has no invariant TSC, rebuild without TIMER=tsc\n");
+			std::exit(1);
+		}
+		clock::time_point c0 = clock::now();
+		std::uint64_t t0 = ReadTscBegin();
+		clock::time_point c1;
+		do {
+			c1 = clock::now();
+		} while (c1 - c0 < std::chrono::milliseconds(20));
+		std::uint64_t t1 = ReadTscEnd();
+		return std::chrono::duration<double, std::nano>(c1 - c0).count() / static_cast<double>(t1 - t0);
+	}();
+	return period;
+#else
+	return 0;
+#endif
+}
+
 Timer::Timer()
 {
 	elapsedTime = duration::zero();
+#ifdef GPPC_TSC_TIMER
+	TscPeriod(); // calibrate outside of the timed region
+#endif
 }
 
 void Timer::StartTimer()
 {
+#ifdef GPPC_TSC_TIMER
+	startTicks = ReadTscBegin();
+#else
 	startTime = clock::now();
+#endif
 }
 
 Timer::duration Timer::EndTimer()
 {
+#ifdef GPPC_TSC_TIMER
+	std::uint64_t stopTicks = ReadTscEnd();
+	elapsedTime = duration(static_cast<duration::rep>(static_cast<double>(stopTicks - startTicks) * TscPeriod() + 0.5));
+#else
 	clock::time_point stopTime = clock::now();
 	
 	elapsedTime = std::chrono::duration_cast<std::chrono::nanoseconds>(stopTime - startTime);
+#endif
 	return elapsedTime;
 }
@@ -25,14 +25,31 @@ SOFTWARE.
 
 #include <fstream>
 #include <chrono>
+#include <cstdint>
 
+#if defined(GPPC_TSC_TIMER) && !(defined(__x86_64__) || defined(__i386__))
+#error "GPPC_TSC_TIMER requires an x86 invariant TSC"
+#endif
+
+/**
+ * Elapsed time of a code region.
+ * Built with GPPC_TSC_TIMER (`make TIMER=tsc`) the timer reads the invariant TSC with fenced
+ * rdtsc/rdtscp instead of steady_clock, converted to nanoseconds by a one-off calibration.
+ */
 class Timer {
 public:
 	typedef std::chrono::steady_clock clock;
 	typedef std::chrono::nanoseconds duration;
 
+	// nanoseconds per TSC tick, calibrated against clock on first use; exits if the TSC is not invariant
+	static double TscPeriod();
+
 private:
+#ifdef GPPC_TSC_TIMER
+	std::uint64_t startTicks;
+#else
 	clock::time_point startTime;
+#endif
 
 	duration elapsedTime;
 
@@ -0,0 +1,171 @@
+#ifndef OPT_GPPC_WEIGHTED_ASTAR_SEARCH_HXX
+#define OPT_GPPC_WEIGHTED_ASTAR_SEARCH_HXX
+
+#include "BaselineSearch.hxx"
+#include <cmath>
+
+namespace baseline
+{
+
+using std::uint64_t;
+
+/**
+ * Bounded-suboptimal weighted A* on the octile grid.
+ * Nodes are ordered by f = g + w * h with the consistent octile heuristic and are never re-opened
+ * once expanded, which keeps the length of every path found within w times the optimal length.
+ * Costs are real lengths (1 and sqrt(2)) in double, COST_0/COST_1 underestimate sqrt(2) and would only
+ * bound the integer cost, so w = 1 is plain A* returning optimal paths.
+ * Per-node state is tagged with the query generation, so no per-query clearing is required.
+ */
+template <typename Layout = RowMajorLayout>
+struct WeightedAStarSearch : Grid<Layout>
+{
+	using Grid<Layout>::size;
+	using Grid<Layout>::pack;
+	using Grid<Layout>::unpack;
+	using Grid<Layout>::get;
+	static constexpr double SQRT2 = 1.4142135623730951;
+
+	WeightedAStarSearch(const std::vector<bool>& l_cells, int l_width, int l_height, double l_weight = 1.0) :
+		 Grid<Layout>(l_cells, l_width, l_height)
+		,weight(std::max(1.0, l_weight))
+		,generation(0)
+	{
+		state.assign(size(), State{0, 0, Node::NO_PRED, false});
+	}
+
+	// suboptimality bound
+	double get_weight() const noexcept { return weight; }
+	// length of the last path found
+	double get_cost() const noexcept { return path_cost; }
+	// nodes expanded by the last search
+	uint64_t get_expansions() const noexcept { return expansions; }
+	// bool search found a path, the path from s to g is written to out, out is empty otherwise
+	template <typename Loc>
+	bool search(Point s, Point g, std::vector<Loc>& out)
+	{
+		out.clear();
+		expansions = 0;
+		if (!get(s) || !get(g))
+			return false;
+		if (s == g) {
+			// zero path case
+			out.resize(2);
+			to_loc(out[0], s); to_loc(out[1], s);
+			path_cost = 0;
+			return true;
+		}
+		next_generation();
+		open.clear();
+		uint32_t sid = pack(s), gid = pack(g);
+		state[sid] = State{generation, 0, Node::NO_PRED, false};
+		push(OpenNode{weight * octile(s, g), 0, sid});
+		while (!open.empty()) {
+			std::pop_heap(open.begin(), open.end(), std::greater<OpenNode>());
+			OpenNode n = open.back(); open.pop_back();
+			State& S = state[n.id];
+			if (S.closed || n.g != S.g)
+				continue; // stale
+			S.closed = true;
+			expansions++;
+			if (n.id == gid) {
+				finalise_path(gid, out);
+				path_cost = n.g;
+				return true;
+			}
+			expand(n, g);
+		}
+		return false;
+	}
+
+private:
+	struct State
+	{
+		uint32_t gen;
+		double g;
+		uint32_t pred;
+		bool closed;
+	};
+	struct OpenNode
+	{
+		double f; // g + weight * h
+		double g;
+		uint32_t id;
+		bool operator>(const OpenNode& o) const noexcept
+		{
+			// tie-break towards deeper nodes
+			return f != o.f ? f > o.f : g < o.g;
+		}
+	};
+
+	void next_generation()
+	{
+		if (++generation == 0) {
+			// wrapped, stale tags could alias the new generation
+			for (auto& S : state)
+				S.gen = 0;
+			generation = 1;
+		}
+	}
+	void push(const OpenNode& n)
+	{
+		open.push_back(n);
+		std::push_heap(open.begin(), open.end(), std::greater<OpenNode>());
+	}
+	void expand(const OpenNode& n, Point g)
+	{
+		Point p = unpack(n.id);
+		uint32_t mask = 0;
+		for (int i = 0, dy = -1; dy < 2; dy++)
+		for (int dx = -1; dx < 2; dx++) {
+			mask |= static_cast<uint32_t>(get( Point(p.first + dx, p.second + dy) )) << i++;
+		}
+		mask = ~mask; // 1 = non-trav, 0 = trav
+		auto try_push = [this,&n,p,g](int dx, int dy, double cost) {
+			Point q(p.first + dx, p.second + dy);
+			uint32_t id = pack(q);
+			double gq = n.g + cost;
+			State& S = state[id];
+			if (S.gen == generation && (S.closed || gq >= S.g))
+				return; // closed nodes are not re-opened
+			S = State{generation, gq, n.id, false};
+			push(OpenNode{gq + weight * octile(q, g), gq, id});
+		};
+		if ( (mask & static_cast<uint32_t>(Compass::N)) == 0 ) try_push(0, -1, 1.0);
+		if ( (mask & static_cast<uint32_t>(Compass::E)) == 0 ) try_push(1, 0, 1.0);
+		if ( (mask & static_cast<uint32_t>(Compass::S)) == 0 ) try_push(0, 1, 1.0);
+		if ( (mask & static_cast<uint32_t>(Compass::W)) == 0 ) try_push(-1, 0, 1.0);
+		if ( (mask & static_cast<uint32_t>(Compass::NE)) == 0 ) try_push(1, -1, SQRT2);
+		if ( (mask & static_cast<uint32_t>(Compass::NW)) == 0 ) try_push(-1, -1, SQRT2);
+		if ( (mask & static_cast<uint32_t>(Compass::SE)) == 0 ) try_push(1, 1, SQRT2);
+		if ( (mask & static_cast<uint32_t>(Compass::SW)) == 0 ) try_push(-1, 1, SQRT2);
+	}
+	// octile distance in real length, consistent for 8N moves without corner cutting
+	static double octile(Point a, Point b) noexcept
+	{
+		int dx = std::abs(a.first - b.first), dy = std::abs(a.second - b.second);
+		return dx < dy ? dx * SQRT2 + (dy - dx) : dy * SQRT2 + (dx - dy);
+	}
+	// every edge has length at least 1, write the pred chain backwards from that bound,
+	// one spare slot absorbs rounding of the summed lengths
+	template <typename Loc>
+	void finalise_path(uint32_t gid, std::vector<Loc>& out)
+	{
+		size_t bound = static_cast<size_t>(state[gid].g) + 2, front = bound;
+		out.resize(bound);
+		for (uint32_t id = gid; id != Node::NO_PRED; id = state[id].pred)
+			to_loc(out[--front], unpack(id));
+		out.erase(out.begin(), out.begin() + front);
+	}
+
+	double weight;
+	uint32_t generation;
+	std::vector<State> state;
+	std::vector<OpenNode> open;
+	double path_cost = 0;
+	uint64_t expansions = 0;
+};
+
+} // namespace baseline
+
+#endif
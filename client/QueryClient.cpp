@@ -0,0 +1,236 @@
+/*
+Copyright (c) 2023 Grid-based Path Planning Competition and Contributors <https://gppc.search-conference.org/>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/**
+ * Client and load generator for `./run -serve`.
+ *
+ * Opens a number of connections to the server's Unix domain socket and keeps each one busy with
+ * batches of queries taken in turn from a scenario file, waiting for every response before sending the
+ * next request (closed loop).  Runs for a number of rounds per connection or for a fixed duration, then
+ * reports sustained queries per second, round-trip latency of a batch and server side search time of a
+ * single query.
+ *
+ * Usage: gppc_client <socket> <map> <scen> [-batch B] [-conn C] [-rounds R] [-duration seconds]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "../ScenarioLoader.h"
+#include "../LatencyHistogram.h"
+#include "../QueryProtocol.h"
+
+using namespace GPPC::protocol;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options {
+	std::string socket, mapfile, scenfile;
+	int batch = 64;
+	int connections = 1;
+	long long rounds = 10;
+	double duration = 0;
+};
+
+struct Totals {
+	std::mutex lock;
+	LatencyHistogram batchLatency;
+	LatencyHistogram queryTime;
+	std::uint64_t queries = 0;
+	std::uint64_t noPath = 0;
+	bool failed = false;
+};
+
+int Connect(const std::string &path)
+{
+	sockaddr_un addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr.sun_path))
+		return -1;
+	std::memcpy(addr.sun_path, path.c_str(), path.size());
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+		::close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+template <typename T>
+void Append(std::vector<char> &buf, const T &v)
+{
+	const char *p = reinterpret_cast<const char*>(&v);
+	buf.insert(buf.end(), p, p + sizeof(T));
+}
+
+// send one batch and read its response, server side query times are added to times
+bool RoundTrip(int fd, const std::string &mapfile, const std::vector<Query> &queries,
+               std::vector<std::uint64_t> &times, std::uint64_t &noPath)
+{
+	std::vector<char> req;
+	Append(req, REQUEST_MAGIC);
+	Append(req, static_cast<std::uint32_t>(mapfile.size()));
+	req.insert(req.end(), mapfile.begin(), mapfile.end());
+	Append(req, static_cast<std::uint32_t>(queries.size()));
+	const char *q = reinterpret_cast<const char*>(queries.data());
+	req.insert(req.end(), q, q + queries.size() * sizeof(Query));
+	if (!WriteAll(fd, req.data(), req.size()))
+		return false;
+
+	std::uint32_t head[3];
+	if (!ReadAll(fd, head, sizeof(head)) || head[0] != RESPONSE_MAGIC)
+		return false;
+	if (head[1] != STATUS_OK) {
+		std::fprintf(stderr, "Server cannot load map %s\n", mapfile.c_str());
+		return false;
+	}
+	if (head[2] != queries.size())
+		return false;
+	std::vector<PathPoint> path;
+	for (std::uint32_t i = 0; i < head[2]; i++) {
+		std::uint64_t ns;
+		std::uint32_t size;
+		if (!ReadAll(fd, &ns, sizeof(ns)) || !ReadAll(fd, &size, sizeof(size)))
+			return false;
+		path.resize(size);
+		if (!ReadAll(fd, path.data(), path.size() * sizeof(PathPoint)))
+			return false;
+		times.push_back(ns);
+		noPath += size == 0;
+	}
+	return true;
+}
+
+void RunConnection(const Options &opt, const std::vector<Query> &all, int id, Totals &totals)
+{
+	int fd = Connect(opt.socket);
+	if (fd < 0) {
+		std::fprintf(stderr, "Cannot connect to %s\n", opt.socket.c_str());
+		std::lock_guard<std::mutex> l(totals.lock);
+		totals.failed = true;
+		return;
+	}
+	Clock::time_point stop = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.duration));
+	// connections start at different offsets so they do not send identical batches
+	size_t next = (all.size() / opt.connections) * id;
+	std::vector<Query> queries(opt.batch);
+	std::vector<std::uint64_t> times;
+	for (long long r = 0; opt.duration > 0 ? Clock::now() < stop : r < opt.rounds; r++) {
+		for (auto &q : queries) {
+			q = all[next];
+			next = (next + 1) % all.size();
+		}
+		times.clear();
+		std::uint64_t noPath = 0;
+		Clock::time_point start = Clock::now();
+		bool ok = RoundTrip(fd, opt.mapfile, queries, times, noPath);
+		std::uint64_t rtt = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+		std::lock_guard<std::mutex> l(totals.lock);
+		if (!ok) {
+			totals.failed = true;
+			break;
+		}
+		totals.batchLatency.Record(rtt);
+		for (auto t : times)
+			totals.queryTime.Record(t);
+		totals.queries += times.size();
+		totals.noPath += noPath;
+	}
+	::close(fd);
+}
+
+void PrintLatency(const char *name, const LatencyHistogram &h)
+{
+	std::printf("%s (us): mean %.1f p50 %.1f p90 %.1f p99 %.1f p99.9 %.1f max %.1f\n", name,
+		h.GetMean() / 1e3, h.GetPercentile(50) / 1e3, h.GetPercentile(90) / 1e3,
+		h.GetPercentile(99) / 1e3, h.GetPercentile(99.9) / 1e3, h.GetMax() / 1e3);
+}
+
+bool ParseArgs(int argc, char **argv, Options &opt)
+{
+	if (argc < 4)
+		return false;
+	opt.socket = argv[1];
+	opt.mapfile = argv[2];
+	opt.scenfile = argv[3];
+	for (int i = 4; i + 1 < argc; i += 2) {
+		std::string flag = argv[i];
+		if (flag == "-batch") opt.batch = std::atoi(argv[i+1]);
+		else if (flag == "-conn") opt.connections = std::atoi(argv[i+1]);
+		else if (flag == "-rounds") opt.rounds = std::atoll(argv[i+1]);
+		else if (flag == "-duration") opt.duration = std::atof(argv[i+1]);
+		else return false;
+	}
+	return (argc - 4) % 2 == 0 && opt.batch > 0 && static_cast<std::uint32_t>(opt.batch) <= MAX_QUERIES
+		&& opt.connections > 0 && opt.rounds > 0 && opt.duration >= 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	Options opt;
+	if (!ParseArgs(argc, argv, opt)) {
+		std::printf("Usage %s <socket> <map> <scen> [-batch B] [-conn C] [-rounds R] [-duration seconds]\n", argv[0]);
+		return 1;
+	}
+	ScenarioLoader scen(opt.scenfile.c_str());
+	std::vector<Query> all;
+	for (int x = 0; x < scen.GetNumExperiments(); x++) {
+		Experiment e = scen.GetNthExperiment(x);
+		all.push_back(Query{e.GetStartX(), e.GetStartY(), e.GetGoalX(), e.GetGoalY()});
+	}
+	if (all.empty()) {
+		std::fprintf(stderr, "No experiments in %s\n", opt.scenfile.c_str());
+		return 1;
+	}
+
+	Totals totals;
+	Clock::time_point start = Clock::now();
+	std::vector<std::thread> pool;
+	for (int c = 0; c < opt.connections; c++)
+		pool.emplace_back(RunConnection, std::cref(opt), std::cref(all), c, std::ref(totals));
+	for (auto &th : pool)
+		th.join();
+	double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+	std::printf("connections %d batch %d queries %llu no-path %llu elapsed %.3fs\n", opt.connections, opt.batch,
+		static_cast<unsigned long long>(totals.queries), static_cast<unsigned long long>(totals.noPath), elapsed);
+	std::printf("throughput: %.1f queries/s %.1f batches/s\n", totals.queries / elapsed,
+		totals.batchLatency.GetCount() / elapsed);
+	PrintLatency("batch round trip", totals.batchLatency);
+	PrintLatency("query search time", totals.queryTime);
+	return totals.failed ? 1 : 0;
+}
@@ -0,0 +1,340 @@
+/*
+Copyright (c) 2023 Grid-based Path Planning Competition and Contributors <https://gppc.search-conference.org/>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * Generates benchmark scenarios for a map.
+ *
+ * Start cells are sampled uniformly from connected components with at least two cells.  Every start
+ * is one task: a Dijkstra run over its component with exact octile costs (1 and sqrt(2), no corner
+ * cutting), from which one goal per distance bucket is sampled.  Tasks run in batches on a persistent
+ * pool of threads and are merged in task order, so the output only depends on the seed.
+ * Generation stops once every bucket found so far is full and a batch finds no new bucket, or after
+ * max-starts tasks; buckets left short of per_bucket are reported.
+ *
+ * Usage: gen_scen <map> <out.scen> [-n per_bucket] [-threads T] [-seed S] [-max-starts M]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cctype>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <queue>
+#include <map>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "../ScenarioLoader.h"
+#include "../MapLoader.h"
+
+namespace {
+
+constexpr double BUCKET_WIDTH = 4.0;
+// fixed so the merge order, and with it the output, does not depend on the thread count
+constexpr int BATCH_SIZE = 64;
+constexpr double SQRT2 = 1.4142135623730951;
+constexpr double INF = 1e300;
+
+struct Options {
+	std::string mapfile, scenfile;
+	int perBucket = 10;
+	int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+	std::uint64_t seed = 1;
+	long long maxStarts = 100000;
+};
+
+struct Pair {
+	std::uint32_t start, goal;
+	double dist;
+};
+
+// fixed set of threads running the tasks of one batch at a time
+class WorkerPool {
+public:
+	explicit WorkerPool(int threads)
+		:batch(0), stopping(false)
+	{
+		for (int t = 0; t < threads; t++)
+			workers.emplace_back(&WorkerPool::WorkerLoop, this, t);
+	}
+	~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> l(lock);
+			stopping = true;
+		}
+		start.notify_all();
+		for (auto &w : workers)
+			w.join();
+	}
+
+	// calls work(task, thread) for every task < tasks, returns once all of them are done
+	void Run(int tasks, std::function<void(int, int)> work)
+	{
+		{
+			std::lock_guard<std::mutex> l(lock);
+			this->work = std::move(work);
+			this->tasks = tasks;
+			next = 0;
+			running = static_cast<int>(workers.size());
+			batch++;
+		}
+		start.notify_all();
+		std::unique_lock<std::mutex> l(lock);
+		done.wait(l, [this] { return running == 0; });
+	}
+
+private:
+	void WorkerLoop(int t)
+	{
+		std::uint64_t seen = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> l(lock);
+				start.wait(l, [&] { return stopping || batch != seen; });
+				if (stopping)
+					return;
+				seen = batch;
+			}
+			for (int i; (i = next.fetch_add(1)) < tasks; )
+				work(i, t);
+			std::lock_guard<std::mutex> l(lock);
+			if (--running == 0)
+				done.notify_one();
+		}
+	}
+
+	std::mutex lock;
+	std::condition_variable start, done;
+	std::uint64_t batch;
+	bool stopping;
+	// written by Run before batch is advanced, read by the workers of that batch only
+	std::function<void(int, int)> work;
+	int tasks = 0;
+	std::atomic<int> next{0};
+	int running = 0;
+	std::vector<std::thread> workers;
+};
+
+std::string basename(const std::string &path)
+{
+	std::size_t l = path.find_last_of('/');
+	return l == std::string::npos ? path : path.substr(l + 1);
+}
+
+class Generator {
+public:
+	Generator(const std::vector<bool> &map, int width, int height)
+		:map(map), width(width), height(height)
+	{ }
+
+	// cells of every component with at least two cells, diagonal moves need both cardinals free so
+	// 4-connected components are the 8-connected ones
+	std::vector<std::uint32_t> ComponentCells() const
+	{
+		std::vector<std::uint32_t> cells, component;
+		std::vector<bool> seen(map.size(), false);
+		for (std::uint32_t i = 0; i < map.size(); i++) {
+			if (!map[i] || seen[i])
+				continue;
+			component.assign(1, i);
+			seen[i] = true;
+			for (size_t j = 0; j < component.size(); j++) {
+				int x = component[j] % width, y = component[j] / width;
+				const int dx[4] = {1, -1, 0, 0}, dy[4] = {0, 0, 1, -1};
+				for (int d = 0; d < 4; d++) {
+					if (Get(x + dx[d], y + dy[d])) {
+						std::uint32_t n = Id(x + dx[d], y + dy[d]);
+						if (!seen[n]) {
+							seen[n] = true;
+							component.push_back(n);
+						}
+					}
+				}
+			}
+			if (component.size() >= 2)
+				cells.insert(cells.end(), component.begin(), component.end());
+		}
+		return cells;
+	}
+
+	// single source octile Dijkstra, fills dist for every reachable cell
+	void Dijkstra(std::uint32_t source, std::vector<double> &dist) const
+	{
+		typedef std::pair<double, std::uint32_t> node;
+		std::priority_queue<node, std::vector<node>, std::greater<node>> Q;
+		dist.assign(map.size(), INF);
+		dist[source] = 0;
+		Q.emplace(0, source);
+		while (!Q.empty()) {
+			auto [d, id] = Q.top(); Q.pop();
+			if (d != dist[id])
+				continue;
+			int x = id % width, y = id / width;
+			for (int dy = -1; dy <= 1; dy++)
+			for (int dx = -1; dx <= 1; dx++) {
+				if ((dx == 0 && dy == 0) || !Get(x + dx, y + dy))
+					continue;
+				if (dx != 0 && dy != 0 && (!Get(x + dx, y) || !Get(x, y + dy)))
+					continue; // no corner cutting
+				std::uint32_t n = Id(x + dx, y + dy);
+				double nd = d + (dx != 0 && dy != 0 ? SQRT2 : 1.0);
+				if (nd < dist[n]) {
+					dist[n] = nd;
+					Q.emplace(nd, n);
+				}
+			}
+		}
+	}
+
+	// one goal per bucket from source, sampled uniformly among cells of that bucket
+	std::map<int, Pair> SampleGoals(std::uint32_t source, std::uint64_t seed, std::vector<double> &dist) const
+	{
+		Dijkstra(source, dist);
+		std::mt19937_64 rng(seed);
+		std::map<int, Pair> picked;
+		std::map<int, std::uint64_t> seen;
+		for (std::uint32_t i = 0; i < dist.size(); i++) {
+			if (i == source || dist[i] >= INF)
+				continue;
+			int bucket = static_cast<int>(dist[i] / BUCKET_WIDTH);
+			// reservoir sampling of size one
+			if (std::uniform_int_distribution<std::uint64_t>(0, seen[bucket]++)(rng) == 0)
+				picked[bucket] = Pair{source, i, dist[i]};
+		}
+		return picked;
+	}
+
+	int Width() const { return width; }
+
+private:
+	bool Get(int x, int y) const
+	{
+		return static_cast<unsigned>(x) < static_cast<unsigned>(width) && static_cast<unsigned>(y) < static_cast<unsigned>(height)
+		    && map[Id(x, y)];
+	}
+	std::uint32_t Id(int x, int y) const { return static_cast<std::uint32_t>(y) * width + x; }
+
+	const std::vector<bool> &map;
+	int width, height;
+};
+
+bool ParseArgs(int argc, char **argv, Options &opt)
+{
+	if (argc < 3)
+		return false;
+	opt.mapfile = argv[1];
+	opt.scenfile = argv[2];
+	for (int i = 3; i + 1 < argc; i += 2) {
+		std::string flag = argv[i];
+		if (flag == "-n") opt.perBucket = std::atoi(argv[i+1]);
+		else if (flag == "-threads") opt.threads = std::atoi(argv[i+1]);
+		else if (flag == "-seed") opt.seed = std::strtoull(argv[i+1], nullptr, 10);
+		else if (flag == "-max-starts") opt.maxStarts = std::atoll(argv[i+1]);
+		else return false;
+	}
+	return (argc - 3) % 2 == 0 && opt.perBucket > 0 && opt.threads > 0 && opt.maxStarts > 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	Options opt;
+	if (!ParseArgs(argc, argv, opt)) {
+		std::printf("Usage %s <map> <out.scen> [-n per_bucket] [-threads T] [-seed S] [-max-starts M]\n", argv[0]);
+		return 1;
+	}
+	std::vector<bool> map;
+	int width = 0, height = 0;
+	LoadMap(opt.mapfile.c_str(), map, width, height);
+	Generator gen(map, width, height);
+	std::vector<std::uint32_t> cells = gen.ComponentCells();
+	if (cells.empty()) {
+		std::fprintf(stderr, "%s has no connected pair of cells\n", opt.mapfile.c_str());
+		return 1;
+	}
+
+	std::mt19937_64 rng(opt.seed);
+	std::map<int, std::vector<Pair>> buckets;
+	std::vector<std::vector<double>> dist(opt.threads);
+	WorkerPool pool(opt.threads);
+	long long starts = 0;
+	while (starts < opt.maxStarts) {
+		// draw the batch's starts and task seeds up front so results do not depend on scheduling
+		int batch = static_cast<int>(std::min<long long>(BATCH_SIZE, opt.maxStarts - starts));
+		std::vector<std::uint32_t> source(batch);
+		std::vector<std::uint64_t> seed(batch);
+		for (int i = 0; i < batch; i++) {
+			source[i] = cells[std::uniform_int_distribution<size_t>(0, cells.size() - 1)(rng)];
+			seed[i] = rng();
+		}
+		std::vector<std::map<int, Pair>> result(batch);
+		pool.Run(batch, [&](int i, int t) {
+			result[i] = gen.SampleGoals(source[i], seed[i], dist[t]);
+		});
+		starts += batch;
+
+		bool found = false;
+		for (const auto &r : result) {
+			for (const auto &[bucket, pair] : r) {
+				found |= buckets.count(bucket) == 0;
+				auto &b = buckets[bucket];
+				if (static_cast<int>(b.size()) < opt.perBucket)
+					b.push_back(pair);
+			}
+		}
+		// distances from one start cover every bucket up to its farthest goal, so the buckets found so
+		// far are all reachable; keep sampling while one of them is short or the batch found a new one
+		bool full = true;
+		for (const auto &[bucket, pairs] : buckets)
+			full &= static_cast<int>(pairs.size()) >= opt.perBucket;
+		if (full && !found)
+			break;
+	}
+
+	ScenarioLoader scen;
+	std::string mapname = basename(opt.mapfile);
+	int incomplete = 0;
+	for (const auto &[bucket, pairs] : buckets) {
+		if (static_cast<int>(pairs.size()) < opt.perBucket) {
+			incomplete++;
+			std::fprintf(stderr, "bucket %d has %d of %d experiments\n", bucket, static_cast<int>(pairs.size()), opt.perBucket);
+		}
+		for (const Pair &p : pairs) {
+			scen.AddExperiment(Experiment(p.start % width, p.start / width, p.goal % width, p.goal / width,
+			                              width, height, bucket, p.dist, mapname));
+		}
+	}
+	scen.Save(opt.scenfile.c_str());
+	std::fprintf(stderr, "%d experiments in %d buckets (%d incomplete) from %lld starts\n",
+	             scen.GetNumExperiments(), static_cast<int>(buckets.size()), incomplete, starts);
+	if (incomplete > 0)
+		std::fprintf(stderr, "Warning: %d buckets are short of %d experiments, raise -max-starts to fill them\n",
+		             incomplete, opt.perBucket);
+	return 0;
+}
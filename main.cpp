@@ -30,8 +30,15 @@ SOFTWARE.
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <map>
+#include <cstdint>
 #include "ScenarioLoader.h"
+#include "MapLoader.h"
 #include "Timer.h"
+#include "ResultWriter.h"
+#include "LatencyHistogram.h"
+#include "QueryServer.h"
+#include "PreprocessDriver.h"
 #include "Entry.h"
 #include "validator/ValidatePath.hpp"
 
@@ -52,38 +59,21 @@ int width, height;
 bool pre   = false;
 bool run   = false;
 bool check = false;
+bool convert = false;
+bool serve = false;
+bool preall = false;
+std::vector<std::string> servemaps;
 
-void LoadMap(const char *fname, std::vector<bool> &map, int &width, int &height)
-{
-  FILE *f;
-  f = std::fopen(fname, "r");
-  if (f)
-  {
-    std::fscanf(f, "type octile\nheight %d\nwidth %d\nmap\n", &height, &width);
-    map.resize(height*width);
-    for (int y = 0; y < height; y++)
-    {
-      for (int x = 0; x < width; x++)
-      {
-        char c;
-        do {
-          std::fscanf(f, "%c", &c);
-        } while (std::isspace(c));
-        map[y*width+x] = (c == '.' || c == 'G' || c == 'S');
-      }
-    }
-    std::fclose(f);
-  }
-}
-
-double euclidean_dist(const xyLoc& a, const xyLoc& b) {
-  int dx = std::abs(b.x - a.x);
-  int dy = std::abs(b.y - a.y);
+template <typename Loc>
+double euclidean_dist(const Loc& a, const Loc& b) {
+  double dx = std::abs(b.x - a.x);
+  double dy = std::abs(b.y - a.y);
   double res = std::sqrt(dx * dx + dy * dy);
   return res;
 }
 
-double GetPathLength(const std::vector<xyLoc>& path)
+template <typename Loc>
+double GetPathLength(const std::vector<Loc>& path)
 {
   double len = 0;
   for (int x = 0; x < (int)path.size()-1; x++)
@@ -92,24 +82,48 @@ double GetPathLength(const std::vector<xyLoc>& path)
 }
 
 // returns -1 if valid path, otherwise id of segment where invalidness was detetcted
-int ValidatePath(const std::vector<xyLoc>& thePath)
+template <typename Loc>
+int ValidatePath(const std::vector<Loc>& thePath)
 {
   return inx::ValidatePath(mapData, width, height, thePath);
 }
 
+// default for entries without wide map support, only maps with a side longer than INT16_MAX call it
+__attribute__((weak)) bool GetPathWide(void *, xyLocWide, xyLocWide, std::vector<xyLocWide> &path) {
+  path.clear();
+  return true;
+}
+
+// default for entries that do not count expansions, reported as -1 in result.csv
+__attribute__((weak)) long long GetExpansions(void *) {
+  return -1;
+}
+
+bool CallGetPath(void *data, xyLoc s, xyLoc g, std::vector<xyLoc> &path) {
+  return GetPath(data, s, g, path);
+}
+
+bool CallGetPath(void *data, xyLocWide s, xyLocWide g, std::vector<xyLocWide> &path) {
+  return GetPathWide(data, s, g, path);
+}
+
+template <typename Loc>
 void RunExperiment(void* data) {
   Timer t;
   ScenarioLoader scen(scenfile.c_str());
-  std::vector<xyLoc> thePath;
+  std::vector<Loc> thePath;
 
-  std::string resultfile = "result.csv";
-  std::ofstream fout(resultfile);
-  const std::string header = "map,scen,experiment_id,path_size,path_length,ref_length,time_cost,20steps_cost,max_step_time";
+  bool binary = std::getenv("GPPC_BINARY_RESULT") != nullptr;
+  bool async = std::getenv("GPPC_ASYNC_OUTPUT") != nullptr;
+  ResultWriter result(binary ? "result.bin" : "result.csv", mapfile, scenfile, binary, async);
+  OutputStream checkout(stdout, async);
+  const char* histfile = std::getenv("GPPC_LATENCY_HISTOGRAM");
+  std::map<int, LatencyHistogram> bucketHist;
+  LatencyHistogram allHist;
 
-  fout << header << std::endl;
   for (int x = 0; x < scen.GetNumExperiments(); x++)
   {
-    xyLoc s, g;
+    Loc s, g;
     s.x = scen.GetNthExperiment(x).GetStartX();
     s.y = scen.GetNthExperiment(x).GetStartY();
     g.x = scen.GetNthExperiment(x).GetGoalX();
@@ -119,10 +133,13 @@ void RunExperiment(void* data) {
     typedef Timer::duration dur;
     dur max_step = dur::zero(), tcost = dur::zero(), tcost_first = dur::zero();
     bool done = false, done_first = false;
+    long long expansions = 0;
     do {
       t.StartTimer();
-      done = GetPath(data, s, g, thePath);
+      done = CallGetPath(data, s, g, thePath);
       t.EndTimer();
+      long long e = GetExpansions(data);
+      expansions = e < 0 || expansions < 0 ? -1 : expansions + e;
       max_step = std::max(max_step, t.GetElapsedTime());
       tcost += t.GetElapsedTime();
       if (!done_first) {
@@ -134,28 +151,47 @@ void RunExperiment(void* data) {
     double ref_len = scen.GetNthExperiment(x).GetDistance();
 
 
-    fout << std::setprecision(9) << std::fixed;
-    fout << mapfile  << "," << scenfile       << ","
-         << x        << "," << thePath.size() << ","
-         << plen     << "," << ref_len        << ","
-         << tcost.count() << "," << tcost_first.count() << ","
-         << max_step.count() << std::endl;
+    ResultRecord r;
+    r.experiment_id = x;
+    r.path_size = static_cast<std::int64_t>(thePath.size());
+    r.path_length = plen;
+    r.ref_length = ref_len;
+    r.time_cost = tcost.count();
+    r.first_steps_cost = tcost_first.count();
+    r.max_step_time = max_step.count();
+    r.expansions = expansions;
+    r.suboptimality = Suboptimality(plen, ref_len);
+    result.Add(r);
+    if (histfile != nullptr) {
+      bucketHist[scen.GetNthExperiment(x).GetBucket()].Record(tcost.count());
+      allHist.Record(tcost.count());
+    }
 
     if (check) {
-      std::printf("%d %d %d %d", s.x, s.y, g.x, g.y);
+      checkout.Put(static_cast<long long>(s.x)); checkout.Put(' ');
+      checkout.Put(static_cast<long long>(s.y)); checkout.Put(' ');
+      checkout.Put(static_cast<long long>(g.x)); checkout.Put(' ');
+      checkout.Put(static_cast<long long>(g.y));
       int validness = ValidatePath(thePath);
       if (validness < 0) {
-        std::printf(" valid");
+        checkout.Put(" valid");
       } else {
-        std::printf(" invalid-%d", validness);
+        checkout.Put(" invalid-");
+        checkout.Put(static_cast<long long>(validness));
       }
-      std::printf(" %d", static_cast<int>(thePath.size()));
+      checkout.Put(' ');
+      checkout.Put(static_cast<long long>(thePath.size()));
       for (const auto& it: thePath) {
-        std::printf(" %d %d", it.x, it.y);
+        checkout.Put(' '); checkout.Put(static_cast<long long>(it.x));
+        checkout.Put(' '); checkout.Put(static_cast<long long>(it.y));
       }
-      std::printf(" %.5f\n", plen);
+      checkout.Put(' ');
+      checkout.PutFixed(plen, 5);
+      checkout.Put('\n');
     }
   }
+  if (histfile != nullptr && !WriteLatencyReport(histfile, bucketHist, allHist))
+    std::fprintf(stderr, "Cannot write latency histogram %s\n", histfile);
 }
 
 void print_help(char **argv) {
@@ -163,8 +199,11 @@ void print_help(char **argv) {
   std::printf("Flags:\n");
   std::printf("\t-full : Preprocess map and run scenario\n");
   std::printf("\t-pre : Preprocess map\n");
+  std::printf("\t-pre-all : Preprocess every map in directory or list file <maps>\n");
   std::printf("\t-run : Run scenario without preprocessing\n");
   std::printf("\t-check: Run for validation\n");
+  std::printf("\t-convert: Convert binary result <result.bin> to csv <result.csv>\n");
+  std::printf("\t-serve: Answer queries on Unix socket <socket> (\"-\" for stdin/stdout), optionally preloading [maps...]\n");
 }
 
 bool parse_argv(int argc, char **argv) {
@@ -172,13 +211,24 @@ bool parse_argv(int argc, char **argv) {
   flag = std::string(argv[1]);
   if (flag == "-full") pre = run = true;
   else if (flag == "-pre") pre = true;
+  else if (flag == "-pre-all") preall = true;
   else if (flag == "-run") run = true;
   else if (flag == "-check") run = check = true;
+  else if (flag == "-convert") convert = true;
+  else if (flag == "-serve") serve = true;
   else return false;
 
+  // <result.bin> <result.csv> are read by main, they are not a map and scenario
+  if (convert) return argc >= 4;
+
   if (argc < 3) return false;
   mapfile = std::string(argv[2]);
 
+  if (serve) {
+    servemaps.assign(argv + 3, argv + argc);
+    return true;
+  }
+
   if (run) {
     if (argc < 4) return false;
     scenfile = std::string(argv[3]);
@@ -195,6 +245,61 @@ std::string basename(const std::string& path) {
   return path.substr(l, r-l);
 }
 
+std::string DataFile(const std::string& path) {
+  return index_dir + "/" + GetName() + "-" + basename(path);
+}
+
+// -serve: mapfile holds the socket path, or "-" to read requests from stdin and answer on stdout
+int Serve() {
+  const char* threads_env = std::getenv("GPPC_SERVE_THREADS");
+  unsigned threads = threads_env != nullptr ? static_cast<unsigned>(std::atoi(threads_env))
+                                            : std::thread::hardware_concurrency();
+  QueryServer server(DataFile, [](const std::string& path, ResidentMap& map) {
+    LoadMap(path.c_str(), map.bits, map.width, map.height);
+    map.datafile = DataFile(path);
+    return map.width > 0 && map.height > 0;
+  }, std::max(threads, 1u));
+  for (const auto& m: servemaps) {
+    if (!server.Preload(m))
+      return 1;
+  }
+  if (mapfile == "-") {
+    server.ServeStream(STDIN_FILENO, STDOUT_FILENO);
+    return 0;
+  }
+  return server.ServeSocket(mapfile) ? 0 : 1;
+}
+
+// -pre-all: mapfile holds a directory of maps or a file listing them
+int PreprocessAll() {
+  std::vector<std::string> maps = ListMaps(mapfile);
+  if (maps.empty()) {
+    std::fprintf(stderr, "No maps in %s\n", mapfile.c_str());
+    return 1;
+  }
+  PreprocessOptions opt;
+  const char* jobs_env = std::getenv("GPPC_PREPROCESS_JOBS");
+  opt.jobs = jobs_env != nullptr ? static_cast<unsigned>(std::atoi(jobs_env)) : std::thread::hardware_concurrency();
+  opt.multiCpu = ReadConfigFlag("config.json", "multi_cpu_preprocessing");
+  // outputs only depend on the code behind GetName, bumped by GPPC_PREPROCESS_VERSION when PreprocessMap changes
+  const char* version_env = std::getenv("GPPC_PREPROCESS_VERSION");
+  opt.producer = GetName() + "/" + (version_env != nullptr ? version_env : "");
+  const char* exe_env = std::getenv("GPPC_PREPROCESS_EXE_CHECK");
+  opt.exeChecksum = exe_env != nullptr && std::atoi(exe_env) != 0;
+  // the example Entry.cpp is configured through BASELINE_* variables
+  opt.envPrefixes = {"BASELINE_"};
+  const char* memory_env = std::getenv("GPPC_PREPROCESS_MEMORY_MB");
+  if (memory_env != nullptr)
+    opt.memoryCap = static_cast<size_t>(std::atoll(memory_env)) << 20;
+  bool ok = PreprocessMaps(maps, DataFile, [](const std::string& path, const std::string& data) {
+    std::vector<bool> bits;
+    int w = 0, h = 0;
+    LoadMap(path.c_str(), bits, w, h);
+    PreprocessMap(bits, w, h, data);
+  }, opt, stdout);
+  return ok ? 0 : 1;
+}
+
 int main(int argc, char **argv)
 {
 
@@ -203,6 +308,15 @@ int main(int argc, char **argv)
     return 1;
   }
 
+  if (convert) {
+    std::string binfile(argv[2]), csvfile(argv[3]);
+    if (!ConvertResultToCsv(binfile.c_str(), csvfile.c_str())) {
+      std::fprintf(stderr, "Cannot convert %s to %s\n", binfile.c_str(), csvfile.c_str());
+      return 1;
+    }
+    return 0;
+  }
+
   bool redirect_output = std::getenv("GPPC_REDIRECT_OUTPUT") != nullptr;
   if (redirect_output) {
     // redirect stdout to file
@@ -210,9 +324,14 @@ int main(int argc, char **argv)
     std::freopen("run.stderr", "w", stderr);
   }
 
+  if (serve)
+    return Serve();
+  if (preall)
+    return PreprocessAll();
+
   // in mapData, 1: traversable, 0: obstacle
   LoadMap(mapfile.c_str(), mapData, width, height);
-  datafile = index_dir + "/" + GetName() + "-" + basename(mapfile);
+  datafile = DataFile(mapfile);
 
   if (pre)
     PreprocessMap(mapData, width, height, datafile);
@@ -230,7 +349,10 @@ int main(int argc, char **argv)
     std::system(argument);
   }
 #endif
-  RunExperiment(reference);
+  if (width > INT16_MAX || height > INT16_MAX)
+    RunExperiment<xyLocWide>(reference);
+  else
+    RunExperiment<xyLoc>(reference);
 #ifdef GPPC_MEMORY_RECORD
   if (memory_track) {
     std::sprintf(argument, "pmap -x %d | tail -n 1 >> run.info", getpid());